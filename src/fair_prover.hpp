@@ -22,7 +22,7 @@ public:
         for (size_t i = 0; i < s.size(); i++) {
             auto inv = s[i].inversed();
             std::cout << inv.get_value() << " ";
-            inv *= inv;
+            inv = inv.square();
             if (rnd() % 2) {
                 I.push_back(inv);
             } else {
@@ -36,22 +36,31 @@ public:
 
     Message Respond(Message message) override {
         size_t iter = message.iter;
+        // the answer is created before the round, so that it outlives it
+        ModuledBigInt answer;
         if (iter % 2 == 0) {
-            R = GetRandomNumber();
-            std::cout << "P: X = " << (R * R).get_value() << std::endl;
-            return {iter, {R * R}, Respond::kProver};
+            {
+                BigInteger::Round round;
+                R = GetRandomNumber();
+                answer = R.square();
+            }
+            std::cout << "P: X = " << answer.get_value() << std::endl;
         } else {
-            ModuledBigInt now = R;
-            std::cout << "P: Y = " << R.get_value();
-            for (size_t i = 0; i < k; i++) {
-                if (message.arr[i].get_value() == 1) {
-                    now *= s[i];
-                    std::cout << " * " << s[i].get_value();
+            {
+                BigInteger::Round round;
+                ModuledBigInt now = R;
+                std::cout << "P: Y = " << R.get_value();
+                for (size_t i = 0; i < k; i++) {
+                    if (message.arr[i].get_value() == 1) {
+                        now *= s[i];
+                        std::cout << " * " << s[i].get_value();
+                    }
                 }
+                answer = now;
             }
-            std::cout << " = " << now.get_value() << std::endl;
-            return {iter, {now}, Respond::kProver};
+            std::cout << " = " << answer.get_value() << std::endl;
         }
+        return {iter, {answer}, Respond::kProver};
     }
 
 private:
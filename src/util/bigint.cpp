@@ -1,28 +1,33 @@
 #include "bigint.hpp"
 
-#include "fft.hpp"
+#include <bit>
+#include <cstring>
+#include <vector>
+
+#include "exponent.hpp"
+#include "limbs.hpp"
+#include "multiply.hpp"
+#include "thresholds.hpp"
 
 /*
- * digit_groups consist of blocks of BASELEN digits
+ * limbs are binary digits in base 2^LIMB_BITS
  * positive represents the sign of the number
- * digit_groups are numbered from least significant to most significant
- * digit_groups can't end with zeroes
- * 0 is always like this: digit_groups is empty, positive is true
+ * limbs are numbered from least significant to most significant
+ * limbs can't end with zeroes
+ * 0 is always like this: limbs is empty, positive is true
  */
 
 bool is_digit(char c) { return '0' <= c && c <= '9'; }
 
 void BigInteger::fix_zero_digits() {
-  while (!digit_groups.empty() && digit_groups.back() == 0) {
-    digit_groups.pop_back();
+  while (!limbs.empty() && limbs.back() == 0) {
+    limbs.pop_back();
   }
-  if (digit_groups.empty()) {
+  if (limbs.empty()) {
     positive = true;
   }
 }
 
-BigInteger::BigInteger() : positive(true) {}
-
 BigInteger::BigInteger(const std::string& number) : positive(true) {
   if (number.empty()) {
     throw std::logic_error("Empty string in BigInteger constructor");
@@ -37,49 +42,105 @@ BigInteger::BigInteger(const std::string& number) : positive(true) {
     throw std::logic_error(
         "Got strange symbol in BigInteger string constructor");
   }
-  size_t i = 0;
-  while (number.size() > i + start) {
-    size_t to = std::min(i + BASELEN, number.size() - start);
-    long long cur_number = 0;
-    long long power = 1;
-    for (size_t j = i; j < to; ++j) {
-      char digit = number[number.size() - j - 1];
-      if (!is_digit(digit)) {
-        throw std::logic_error(
-            "Got strange symbol in BigIntger string constructor");
+  if (!std::all_of(number.begin() + start, number.end(), is_digit)) {
+    throw std::logic_error(
+        "Got strange symbol in BigIntger string constructor");
+  }
+  limbs = from_decimal(number.data() + start, number.size() - start).limbs;
+  fix_zero_digits();
+}
+
+const BigInteger::Reciprocal& BigInteger::decimal_power(size_t level) {
+  thread_local std::vector<Reciprocal> powers;
+  if (powers.size() > level) {
+    return powers[level];
+  }
+  // the cache outlives any scoped memory resource
+  MemoryScope heap(nullptr);
+  if (powers.empty()) {
+    powers.emplace_back(BigInteger(limb_vector{DECIMAL_BASE}, true));
+  }
+  while (powers.size() <= level) {
+    powers.emplace_back(powers.back().divisor().square());
+  }
+  return powers[level];
+}
+
+// the lower part is a power of two number of blocks, so that the powers
+// of the base it is multiplied by can be cached
+BigInteger BigInteger::from_decimal(const char* digits, size_t length) {
+  if (length <= DECIMAL_BASELEN * DECIMAL_CONVERSION_THRESHOLD) {
+    BigInteger ans;
+    // the first block is the shortest one, all the others have BASELEN digits
+    size_t block_len = length % DECIMAL_BASELEN;
+    if (block_len == 0) {
+      block_len = DECIMAL_BASELEN;
+    }
+    for (size_t i = 0; i < length; i += block_len,
+                block_len = DECIMAL_BASELEN) {
+      limb_t cur_number = 0;
+      limb_t power = 1;
+      for (size_t j = i; j < i + block_len; ++j) {
+        cur_number = cur_number * 10 + (digits[j] - '0');
+        power *= 10;
       }
-      cur_number += (digit - '0') * power;
-      power *= 10;
+      ans.multiply_add_limb(power, cur_number);
     }
-    digit_groups.emplace_back(cur_number);
-    i = to;
+    ans.fix_zero_digits();
+    return ans;
   }
-  fix_zero_digits();
+  size_t level = 0;
+  while ((DECIMAL_BASELEN << (level + 1)) < length) {
+    ++level;
+  }
+  size_t low_length = DECIMAL_BASELEN << level;
+  BigInteger ans = from_decimal(digits + length - low_length, low_length);
+  ans.addmul(from_decimal(digits, length - low_length),
+             decimal_power(level).divisor());
+  return ans;
 }
 
-BigInteger::BigInteger(long long number) : positive(number >= 0) {
-  if (positive) {
-    while (number) {
-      digit_groups.emplace_back(number % BASE);
-      number /= BASE;
+// the number is divided by a power of the base of about half its length
+void BigInteger::to_decimal(std::string& out, size_t width) const {
+  if (limbs.size() <= DECIMAL_CONVERSION_THRESHOLD) {
+    std::vector<limb_t> blocks;
+    BigInteger copy(limbs, true);
+    while (!copy.is_zero()) {
+      blocks.emplace_back(copy.divide_limb(DECIMAL_BASE));
     }
-  } else {
-    while (number) {
-      digit_groups.emplace_back(-(number % BASE));
-      number /= BASE;
+    std::string digits;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      std::string block = to_string(blocks[blocks.size() - i - 1]);
+      if (i != 0) {
+        digits.append(DECIMAL_BASELEN - block.size(), '0');
+      }
+      digits += block;
+    }
+    if (digits.size() < width) {
+      out.append(width - digits.size(), '0');
     }
+    out += digits;
+    return;
   }
+  size_t level = 0;
+  while (2 * decimal_power(level + 1).divisor().limbs.size() <=
+         limbs.size()) {
+    ++level;
+  }
+  auto [high, low] = divide(*this, decimal_power(level));
+  size_t low_width = DECIMAL_BASELEN << level;
+  high.to_decimal(out, width > low_width ? width - low_width : 0);
+  low.to_decimal(out, low_width);
 }
 
 BigInteger::operator long long() const {
-  long long ans = 0;
-  for (size_t i = 0; i < digit_groups.size(); ++i) {
-    ans = ans * BASE + digit_groups[digit_groups.size() - i - 1];
+  if (limbs.empty()) {
+    return 0;
   }
   if (!positive) {
-    ans *= -1;
+    return static_cast<long long>(-limbs[0]);
   }
-  return ans;
+  return static_cast<long long>(limbs[0]);
 }
 
 BigInteger::operator std::string() const {
@@ -87,23 +148,15 @@ BigInteger::operator std::string() const {
   if (!positive) {
     ans += '-';
   }
-  for (size_t i = 0; i < digit_groups.size(); ++i) {
-    std::string block = to_string(digit_groups[digit_groups.size() - i - 1]);
-    if (i != 0) {
-      for (size_t j = block.size(); j < BASELEN; ++j) {
-        ans += '0';
-      }
-    }
-    ans += block;
-  }
   // zero
-  if (digit_groups.empty()) {
+  if (is_zero()) {
     ans += '0';
   }
+  to_decimal(ans, 0);
   return ans;
 }
 
-bool BigInteger::is_zero() const { return digit_groups.empty(); }
+bool BigInteger::is_zero() const { return limbs.empty(); }
 
 bool BigInteger::is_positive() const { return positive && !is_zero(); }
 
@@ -112,36 +165,40 @@ bool BigInteger::is_negative() const { return !positive; }
 BigInteger::operator bool() const { return !is_zero(); }
 
 BigInteger::BigInteger(BigInteger&& other)
-    : digit_groups(std::move(other.digit_groups)), positive(other.positive) {
+    : limbs(std::move(other.limbs)), positive(other.positive) {
   // clear up other
   other.positive = true;
-  other.digit_groups.clear();
+  other.limbs.clear();
 }
 
+BigInteger::BigInteger(const BigInteger& other,
+                       std::pmr::memory_resource* resource)
+    : limbs(other.limbs, resource), positive(other.positive) {}
+
 BigInteger& BigInteger::operator=(BigInteger&& other) {
   positive = other.positive;
-  digit_groups = std::move(other.digit_groups);
+  limbs = std::move(other.limbs);
   // clear up other
   other.positive = true;
-  other.digit_groups.clear();
+  other.limbs.clear();
   return *this;
 }
 
-std::strong_ordering BigInteger::compare_digit_groups(
-    const std::vector<long long>& digit_groups_left,
-    const std::vector<long long>& digit_groups_right) {
-  if (digit_groups_left.size() != digit_groups_right.size()) {
-    return digit_groups_left.size() <=> digit_groups_right.size();
-  }
-  for (size_t i = 0; i < digit_groups_left.size(); ++i) {
-    long long left_block = digit_groups_left[digit_groups_left.size() - i - 1];
-    long long right_block =
-        digit_groups_right[digit_groups_right.size() - i - 1];
-    if (left_block != right_block) {
-      return left_block <=> right_block;
-    }
+std::strong_ordering BigInteger::compare_limbs(const limb_t* left,
+                                               size_t left_size,
+                                               const limb_t* right,
+                                               size_t right_size) {
+  if (left_size != right_size) {
+    return left_size <=> right_size;
   }
-  return std::strong_ordering::equal;
+  return Limbs::compare_n({left, left_size}, {right, right_size});
+}
+
+std::strong_ordering BigInteger::compare_limbs(
+    const limb_vector& limbs_left,
+    const limb_vector& limbs_right) {
+  return compare_limbs(limbs_left.data(), limbs_left.size(),
+                       limbs_right.data(), limbs_right.size());
 }
 
 std::strong_ordering BigInteger::operator<=>(const BigInteger& other) const {
@@ -149,7 +206,7 @@ std::strong_ordering BigInteger::operator<=>(const BigInteger& other) const {
     return positive ? std::strong_ordering::greater
                     : std::strong_ordering::less;
   }
-  auto result = compare_digit_groups(digit_groups, other.digit_groups);
+  auto result = compare_limbs(limbs, other.limbs);
   if (positive) {
     return result;
   }
@@ -157,52 +214,38 @@ std::strong_ordering BigInteger::operator<=>(const BigInteger& other) const {
   return 0 <=> result;
 }
 
-void BigInteger::add_with_sign(
-    bool same_sign, const std::vector<long long>& other_digit_groups) {
-  digit_groups.resize(std::max(digit_groups.size(), other_digit_groups.size()));
+void BigInteger::add_with_sign(bool same_sign, const limb_t* other_limbs,
+                               size_t other_size) {
+  std::span<const limb_t> other(other_limbs, other_size);
   if (same_sign) {
-    for (size_t i = 0; i < other_digit_groups.size(); ++i) {
-      digit_groups[i] += other_digit_groups[i];
-    }
-  } else if (compare_digit_groups(digit_groups, other_digit_groups) ==
-             std::strong_ordering::less) {
-    // extra zeroes might have been added but it does not break anything
-    for (size_t i = 0; i < other_digit_groups.size(); ++i) {
-      digit_groups[i] = other_digit_groups[i] - digit_groups[i];
+    limbs.resize(std::max(limbs.size(), other_size));
+    if (Limbs::add(mutable_limbs(), get_limbs(), other) != 0) {
+      limbs.emplace_back(1);
     }
+    return;
+  }
+  if (compare_limbs(limbs.data(), limbs.size(), other_limbs, other_size) ==
+      std::strong_ordering::less) {
+    // |other| > |this|, so the result is |other| - |this| with flipped sign
+    limbs.resize(other_size);
+    Limbs::sub_n(mutable_limbs(), other, get_limbs());
     positive ^= 1;
   } else {
-    for (size_t i = 0; i < other_digit_groups.size(); ++i) {
-      digit_groups[i] -= other_digit_groups[i];
-    }
-  }
-  size_t border = other_digit_groups.size();
-  for (size_t i = 0; i < border; ++i) {
-    if (digit_groups[i] >= BASE) {
-      digit_groups[i] -= BASE;
-      border = max(border, i + 2);
-      if (i + 1 == digit_groups.size()) {
-        digit_groups.emplace_back(1);
-      } else {
-        ++digit_groups[i + 1];
-      }
-    }
-    if (digit_groups[i] < 0) {
-      digit_groups[i] += BASE;
-      // it should exits for sure
-      --digit_groups[i + 1];
-    }
+    // no borrow out of the top since |this| >= |other|
+    Limbs::sub(mutable_limbs(), get_limbs(), other);
   }
   fix_zero_digits();
 }
 
 BigInteger& BigInteger::operator+=(const BigInteger& other) {
-  add_with_sign(positive ^ other.positive ^ 1, other.digit_groups);
+  add_with_sign(positive ^ other.positive ^ 1, other.limbs.data(),
+                other.limbs.size());
   return *this;
 }
 
 BigInteger& BigInteger::operator-=(const BigInteger& other) {
-  add_with_sign(positive ^ other.positive, other.digit_groups);
+  add_with_sign(positive ^ other.positive, other.limbs.data(),
+                other.limbs.size());
   return *this;
 }
 
@@ -218,71 +261,303 @@ BigInteger operator-(const BigInteger& a, const BigInteger& b) {
   return copy;
 }
 
-BigInteger::BigInteger(const std::vector<long long>& digit_groups,
-                       bool positive)
-    : digit_groups(digit_groups), positive(positive) {
+BigInteger operator+(BigInteger&& a, const BigInteger& b) {
+  a += b;
+  return std::move(a);
+}
+
+BigInteger operator+(const BigInteger& a, BigInteger&& b) {
+  b += a;
+  return std::move(b);
+}
+
+BigInteger operator+(BigInteger&& a, BigInteger&& b) {
+  a += b;
+  return std::move(a);
+}
+
+BigInteger operator-(BigInteger&& a, const BigInteger& b) {
+  a -= b;
+  return std::move(a);
+}
+
+BigInteger operator-(const BigInteger& a, BigInteger&& b) {
+  b -= a;
+  return -std::move(b);
+}
+
+BigInteger operator-(BigInteger&& a, BigInteger&& b) {
+  a -= b;
+  return std::move(a);
+}
+
+BigInteger::BigInteger(const limb_vector& limbs, bool positive)
+    : limbs(limbs), positive(positive) {
   fix_zero_digits();
 }
 
-BigInteger::BigInteger(std::vector<long long>&& digit_groups, bool positive)
-    : digit_groups(std::move(digit_groups)), positive(positive) {
+BigInteger::BigInteger(limb_vector&& limbs, bool positive)
+    : limbs(std::move(limbs)), positive(positive) {
   fix_zero_digits();
 }
 
-BigInteger operator*(const BigInteger& a, const BigInteger& b) {
-  std::vector<long long> res_digit_groups = FFT::multiply_poly<long long>(
-      a.digit_groups.begin(), a.digit_groups.end(), b.digit_groups.begin(),
-      b.digit_groups.end());
-  for (size_t i = 0; i < res_digit_groups.size(); ++i) {
-    if (res_digit_groups[i] >= BigInteger::BASE) {
-      // it should exist
-      if (i + 1 == res_digit_groups.size()) {
-        res_digit_groups.emplace_back();
-      }
-      res_digit_groups[i + 1] += res_digit_groups[i] / BigInteger::BASE;
-      res_digit_groups[i] %= BigInteger::BASE;
+BigInteger BigInteger::from_double_limb(double_limb_t value) {
+  return BigInteger(limb_vector{limb_t(value), limb_t(value >> LIMB_BITS)},
+                    true);
+}
+
+BigInteger::double_limb_t BigInteger::to_double_limb() const {
+  double_limb_t ans = 0;
+  for (size_t i = std::min(limbs.size(), size_t(2)); i > 0; --i) {
+    ans = (ans << LIMB_BITS) | limbs[i - 1];
+  }
+  return ans;
+}
+
+class BigInteger::Scratch {
+ public:
+  // the shared buffer may be in use by a call up the stack of this thread,
+  // then the space is allocated for this call alone
+  explicit Scratch(size_t size) : shared(thread_buffer()) {
+    if (shared.in_use) {
+      own.resize(size);
+      space = own;
+      return;
+    }
+    shared.in_use = holds_shared = true;
+    if (shared.limbs.size() < size) {
+      shared.limbs.resize(size);
+    }
+    space = shared.limbs;
+  }
+  Scratch(const Scratch&) = delete;
+  Scratch& operator=(const Scratch&) = delete;
+  ~Scratch() {
+    if (!holds_shared) {
+      return;
+    }
+    if (shared.limbs.size() > SPARE_LIMBS_LIMIT) {
+      shared.limbs = std::vector<limb_t>();
     }
+    shared.in_use = false;
+  }
+
+  operator std::span<limb_t>() { return space; }
+
+ private:
+  struct Buffer {
+    std::vector<limb_t> limbs;
+    bool in_use = false;
+  };
+
+  static Buffer& thread_buffer() {
+    thread_local Buffer buffer;
+    return buffer;
+  }
+
+  Buffer& shared;
+  bool holds_shared = false;
+  std::vector<limb_t> own;
+  std::span<limb_t> space;
+};
+
+BigInteger operator*(const BigInteger& a, const BigInteger& b) {
+  if (a.is_zero() || b.is_zero()) {
+    return BigInteger();
+  }
+  if (&a == &b) {
+    return a.square();
+  }
+  BigInteger::limb_vector res_limbs(a.limbs.size() + b.limbs.size());
+  BigInteger::Scratch scratch(
+      Limbs::mul_scratch_size(a.limbs.size(), b.limbs.size()));
+  Limbs::mul({res_limbs.data(), res_limbs.size()}, a.get_limbs(),
+             b.get_limbs(), scratch);
+  return BigInteger(std::move(res_limbs), a.positive ^ b.positive ^ 1);
+}
+
+BigInteger BigInteger::square() const {
+  if (is_zero()) {
+    return BigInteger();
   }
-  BigInteger res(res_digit_groups, a.positive ^ b.positive ^ 1);
-  return res;
+  limb_vector res_limbs(2 * limbs.size());
+  Scratch scratch(Limbs::sqr_scratch_size(limbs.size()));
+  Limbs::sqr({res_limbs.data(), res_limbs.size()}, get_limbs(), scratch);
+  return BigInteger(std::move(res_limbs), true);
+}
+
+BigInteger::limb_vector& BigInteger::spare_limbs() {
+  thread_local limb_vector spare(nullptr);
+  return spare;
 }
 
 BigInteger& BigInteger::operator*=(const BigInteger& other) {
-  return *this = ((*this) * other);
+  return multiply_by(other, nullptr);
+}
+
+BigInteger& BigInteger::operator*=(const Prepared& other) {
+  return multiply_by(other.value_, &other.transform);
+}
+
+BigInteger& BigInteger::multiply_by(const BigInteger& other,
+                                    const Multiply::Prepared* transform) {
+  if (is_zero() || other.is_zero()) {
+    limbs.clear();
+    positive = true;
+    return *this;
+  }
+  // the product can't overlap the operands, so it is formed in the spare
+  // buffer, and the old limbs become the spare buffer for the next time
+  limb_vector& product = spare_limbs();
+  product.clear();
+  product.resize(limbs.size() + other.limbs.size());
+  std::span<limb_t> res(product.data(), product.size());
+  if (this == &other) {
+    Scratch scratch(Limbs::sqr_scratch_size(limbs.size()));
+    Limbs::sqr(res, get_limbs(), scratch);
+  } else if (transform) {
+    transform->multiply(limbs.data(), limbs.size(), other.limbs.data(),
+                        other.limbs.size(), product.data());
+  } else {
+    Scratch scratch(
+        Limbs::mul_scratch_size(limbs.size(), other.limbs.size()));
+    Limbs::mul(res, get_limbs(), other.get_limbs(), scratch);
+  }
+  if (limbs.same_resource(product)) {
+    std::swap(limbs, product);
+  } else {
+    limbs = product;
+  }
+  if (product.capacity() > SPARE_LIMBS_LIMIT) {
+    product = limb_vector();
+  }
+  positive = positive == other.positive;
+  fix_zero_digits();
+  return *this;
+}
+
+BigInteger operator*(const BigInteger& a, const BigInteger::Prepared& b) {
+  const BigInteger& value = b.value_;
+  if (a.is_zero() || value.is_zero()) {
+    return BigInteger();
+  }
+  BigInteger::limb_vector res_limbs(a.limbs.size() + value.limbs.size());
+  b.transform.multiply(a.limbs.data(), a.limbs.size(), value.limbs.data(),
+                       value.limbs.size(), res_limbs.data());
+  return BigInteger(std::move(res_limbs), a.positive ^ value.positive ^ 1);
+}
+
+BigInteger operator*(BigInteger&& a, const BigInteger::Prepared& b) {
+  a *= b;
+  return std::move(a);
+}
+
+BigInteger operator*(BigInteger&& a, const BigInteger& b) {
+  a *= b;
+  return std::move(a);
+}
+
+BigInteger operator*(const BigInteger& a, BigInteger&& b) {
+  b *= a;
+  return std::move(b);
+}
+
+BigInteger operator*(BigInteger&& a, BigInteger&& b) {
+  a *= b;
+  return std::move(a);
+}
+
+void BigInteger::add_product(bool subtract, const BigInteger& a,
+                             const BigInteger& b) {
+  if (a.is_zero() || b.is_zero()) {
+    return;
+  }
+  if (is_zero()) {
+    positive = a.positive ^ b.positive ^ subtract ^ 1;
+  }
+  bool same_sign = positive ^ a.positive ^ b.positive ^ subtract;
+  const BigInteger& longer = a.limbs.size() >= b.limbs.size() ? a : b;
+  const BigInteger& shorter = a.limbs.size() >= b.limbs.size() ? b : a;
+  // a one limb multiplier is accumulated right into this,
+  // unless this is the other operand and gets overwritten while read
+  if (same_sign && shorter.limbs.size() == 1 && this != &longer) {
+    size_t longer_size = longer.limbs.size();
+    // the extra limb reserved here makes sure the carry stops before the end
+    limbs.resize(std::max(limbs.size(), longer_size) + 1);
+    limb_t carry =
+        Limbs::addmul_1(mutable_limbs(), longer.get_limbs(), shorter.limbs[0]);
+    Limbs::add_1(mutable_limbs().subspan(longer_size),
+                 get_limbs().subspan(longer_size), carry);
+    fix_zero_digits();
+    return;
+  }
+  scratch_vector product(a.limbs.size() + b.limbs.size());
+  std::span<limb_t> res(product.data(), product.size());
+  if (&a == &b) {
+    Scratch scratch(Limbs::sqr_scratch_size(a.limbs.size()));
+    Limbs::sqr(res, a.get_limbs(), scratch);
+  } else {
+    Scratch scratch(
+        Limbs::mul_scratch_size(a.limbs.size(), b.limbs.size()));
+    Limbs::mul(res, a.get_limbs(), b.get_limbs(), scratch);
+  }
+  // the product of nonzero numbers has at most one leading zero limb
+  if (product.back() == 0) {
+    product.pop_back();
+  }
+  add_with_sign(same_sign, product.data(), product.size());
+}
+
+BigInteger& BigInteger::addmul(const BigInteger& a, const BigInteger& b) {
+  add_product(false, a, b);
+  return *this;
+}
+
+BigInteger& BigInteger::submul(const BigInteger& a, const BigInteger& b) {
+  add_product(true, a, b);
+  return *this;
+}
+
+BigInteger BigInteger::mul_add(const BigInteger& a, const BigInteger& b,
+                               const BigInteger& c) {
+  BigInteger ans(c);
+  ans.addmul(a, b);
+  return ans;
 }
 
 void BigInteger::add_one_with_sign(bool same_sign) {
   if (same_sign) {
-    if (digit_groups.empty()) {
-      digit_groups.emplace_back();
-    }
-    ++digit_groups[0];
-    size_t i = 0;
-    while (digit_groups[i] >= BASE) {
-      if (i + 1 == digit_groups.size()) {
-        digit_groups.emplace_back();
-      }
-      ++digit_groups[i + 1];
-      digit_groups[i] -= BASE;
-      ++i;
+    if (Limbs::add_1(mutable_limbs(), get_limbs(), 1) != 0) {
+      limbs.emplace_back(1);
     }
   } else {
-    if (digit_groups.empty()) {
-      digit_groups.emplace_back(1);
+    if (limbs.empty()) {
+      limbs.emplace_back(1);
       positive ^= 1;
     } else {
-      --digit_groups[0];
-      size_t i = 0;
-      while (digit_groups[i] < 0) {
-        digit_groups[i] += BASE;
-        --digit_groups[i + 1];
-        ++i;
-      }
+      // no borrow out of the top since the number is not zero
+      Limbs::sub_1(mutable_limbs(), get_limbs(), 1);
     }
     fix_zero_digits();
   }
 }
 
+void BigInteger::multiply_add_limb(limb_t multiplier, limb_t addend) {
+  limb_t carry = Limbs::mul_1(mutable_limbs(), get_limbs(), multiplier);
+  // the product is below BASE^size * multiplier, so adding a limb to it
+  // carries at most into the top limb
+  carry += Limbs::add_1(mutable_limbs(), get_limbs(), addend);
+  if (carry != 0) {
+    limbs.emplace_back(carry);
+  }
+}
+
+BigInteger::limb_t BigInteger::divide_limb(limb_t divisor) {
+  limb_t remainder = Limbs::divrem_1(mutable_limbs(), get_limbs(), divisor);
+  fix_zero_digits();
+  return remainder;
+}
+
 BigInteger& BigInteger::operator++() {
   add_one_with_sign(positive);
   return *this;
@@ -317,27 +592,187 @@ std::ostream& operator<<(std::ostream& os, const BigInteger& x) {
   return os;
 }
 
-BigInteger operator""_bi(const char* buffer) {
-  return BigInteger(std::string(buffer));
+namespace {
+// 8 bytes of a limb in the given order
+void store_limb(uint8_t* out, uint64_t limb, bool big_endian) {
+  if (big_endian != (std::endian::native == std::endian::big)) {
+    limb = __builtin_bswap64(limb);
+  }
+  std::memcpy(out, &limb, sizeof(limb));
+}
+
+uint64_t load_limb(const uint8_t* in, bool big_endian) {
+  uint64_t limb;
+  std::memcpy(&limb, in, sizeof(limb));
+  if (big_endian != (std::endian::native == std::endian::big)) {
+    limb = __builtin_bswap64(limb);
+  }
+  return limb;
+}
+}  // namespace
+
+size_t BigInteger::byte_length() const { return (bit_length() + 7) / 8; }
+
+std::vector<uint8_t> BigInteger::to_bytes(size_t size, ByteOrder order) const {
+  std::vector<uint8_t> bytes(size);
+  to_bytes(bytes, order);
+  return bytes;
+}
+
+void BigInteger::to_bytes(std::span<uint8_t> out, ByteOrder order) const {
+  if (!positive) {
+    throw std::logic_error("Negative BigInteger in a fixed width encoding");
+  }
+  if (byte_length() > out.size()) {
+    throw std::length_error("BigInteger does not fit in the bytes");
+  }
+  store_magnitude(out, order == ByteOrder::kBigEndian);
+}
+
+void BigInteger::store_magnitude(std::span<uint8_t> out,
+                                 bool big_endian) const {
+  size_t size = out.size();
+  const size_t limb_bytes = sizeof(limb_t);
+  size_t full_limbs = std::min(limbs.size(), size / limb_bytes);
+  for (size_t i = 0; i < full_limbs; ++i) {
+    store_limb(big_endian ? out.data() + size - (i + 1) * limb_bytes
+                          : out.data() + i * limb_bytes,
+               limbs[i], big_endian);
+  }
+  // bytes are numbered from the least significant one
+  size_t written = std::min(limbs.size() * limb_bytes, size);
+  for (size_t byte = full_limbs * limb_bytes; byte < written; ++byte) {
+    out[big_endian ? size - 1 - byte : byte] =
+        uint8_t(limbs[byte / limb_bytes] >> (byte % limb_bytes * 8));
+  }
+  auto padding = big_endian ? out.first(size - written) : out.subspan(written);
+  std::fill(padding.begin(), padding.end(), 0);
+}
+
+BigInteger BigInteger::from_bytes(std::span<const uint8_t> in,
+                                  ByteOrder order) {
+  bool big_endian = order == ByteOrder::kBigEndian;
+  size_t size = in.size();
+  const size_t limb_bytes = sizeof(limb_t);
+  limb_vector limbs((size + limb_bytes - 1) / limb_bytes);
+  size_t full_limbs = size / limb_bytes;
+  for (size_t i = 0; i < full_limbs; ++i) {
+    limbs[i] = load_limb(big_endian ? in.data() + size - (i + 1) * limb_bytes
+                                    : in.data() + i * limb_bytes,
+                         big_endian);
+  }
+  for (size_t byte = full_limbs * limb_bytes; byte < size; ++byte) {
+    limb_t value = in[big_endian ? size - 1 - byte : byte];
+    limbs[byte / limb_bytes] |= value << (byte % limb_bytes * 8);
+  }
+  return BigInteger(std::move(limbs), true);
+}
+
+size_t BigInteger::prefixed_size() const {
+  return PREFIX_BYTES + byte_length();
+}
+
+std::vector<uint8_t> BigInteger::to_prefixed_bytes() const {
+  std::vector<uint8_t> bytes(prefixed_size());
+  to_prefixed_bytes(bytes);
+  return bytes;
+}
+
+size_t BigInteger::to_prefixed_bytes(std::span<uint8_t> out) const {
+  size_t length = byte_length();
+  if (length >= (size_t(1) << (PREFIX_BYTES * 8 - 1))) {
+    throw std::length_error("BigInteger is too long for the length prefix");
+  }
+  if (out.size() < PREFIX_BYTES + length) {
+    throw std::length_error("Not enough bytes for BigInteger");
+  }
+  uint64_t header = length * 2 + (positive ? 0 : 1);
+  for (size_t i = 0; i < PREFIX_BYTES; ++i) {
+    out[i] = uint8_t(header >> ((PREFIX_BYTES - 1 - i) * 8));
+  }
+  store_magnitude(out.subspan(PREFIX_BYTES, length), true);
+  return PREFIX_BYTES + length;
+}
+
+std::pair<BigInteger, size_t> BigInteger::from_prefixed_bytes(
+    std::span<const uint8_t> in) {
+  if (in.size() < PREFIX_BYTES) {
+    throw std::length_error("Truncated BigInteger length prefix");
+  }
+  uint64_t header = 0;
+  for (size_t i = 0; i < PREFIX_BYTES; ++i) {
+    header = (header << 8) | in[i];
+  }
+  size_t length = header / 2;
+  if (in.size() - PREFIX_BYTES < length) {
+    throw std::length_error("Truncated BigInteger");
+  }
+  BigInteger ans = from_bytes(in.subspan(PREFIX_BYTES, length));
+  if (header % 2 == 1 && !ans.is_zero()) {
+    ans.positive = false;
+  }
+  return {std::move(ans), PREFIX_BYTES + length};
+}
+
+BigInteger BigInteger::from_limbs(std::span<const uint64_t> limbs,
+                                  bool negative) {
+  return BigInteger(limb_vector(limbs.begin(), limbs.end()), !negative);
+}
+
+BigInteger pow(const BigInteger& base, unsigned long long exponent) {
+  BigInteger result(1);
+  for (int bit = std::bit_width(exponent) - 1; bit >= 0; --bit) {
+    result = result.square();
+    if ((exponent >> bit) & 1) {
+      result *= base;
+    }
+  }
+  return result;
+}
+
+BigInteger BigInteger::pow_mod(const BigInteger& base,
+                               const BigInteger& exponent,
+                               const Reciprocal& modulus) {
+  if (exponent.is_negative()) {
+    throw std::domain_error("Negative exponent in BigInteger::pow_mod");
+  }
+  auto reduce = [&modulus](BigInteger value) {
+    value = divide(std::move(value), modulus).second;
+    if (value.is_negative()) {
+      value += abs(modulus.divisor());
+    }
+    return value;
+  };
+  return Exponent::sliding_window(
+      reduce(base), exponent.get_limbs(), reduce(BigInteger(1)),
+      [&](const BigInteger& a, const BigInteger& b) { return reduce(a * b); },
+      [&](const BigInteger& a) { return reduce(a.square()); });
 }
 
-BigInteger abs(const BigInteger& a) { return BigInteger(a.digit_groups, true); }
+BigInteger abs(const BigInteger& a) { return BigInteger(a.limbs, true); }
 
 BigInteger BigInteger::shift_right(size_t shift) const {
-  if (shift >= digit_groups.size()) return BigInteger();
-  return BigInteger(
-      std::vector<long long>(digit_groups.begin() + shift, digit_groups.end()),
-      positive);
+  if (shift >= limbs.size()) return BigInteger();
+  return BigInteger(limb_vector(limbs.begin() + shift, limbs.end()), positive);
 }
 
 BigInteger BigInteger::shift_left(size_t shift) const {
-  std::vector<long long> new_digits(digit_groups.size() + shift);
-  std::copy(digit_groups.begin(), digit_groups.end(),
-            new_digits.begin() + shift);
-  return BigInteger(std::move(new_digits), positive);
+  limb_vector new_limbs(limbs.size() + shift);
+  std::copy(limbs.begin(), limbs.end(), new_limbs.begin() + shift);
+  return BigInteger(std::move(new_limbs), positive);
 }
 
-#include <iostream>
+void BigInteger::shift_bits_left(unsigned shift) {
+  limb_t overflow = Limbs::lshift(mutable_limbs(), get_limbs(), shift);
+  if (overflow != 0) {
+    limbs.emplace_back(overflow);
+  }
+}
+
+void BigInteger::shift_bits_right(unsigned shift) {
+  Limbs::rshift(mutable_limbs(), get_limbs(), shift);
+  fix_zero_digits();
+}
 
 std::pair<BigInteger, BigInteger> BigInteger::divide21(const BigInteger& a,
                                                        const BigInteger& b,
@@ -345,42 +780,43 @@ std::pair<BigInteger, BigInteger> BigInteger::divide21(const BigInteger& a,
   if (a < b) {
     return {BigInteger(0), a};
   }
-  if (a.digit_groups.size() <= SMALLDIVIDEDIGITS) {
-    long long first(a);
-    long long second(b);
-    return {BigInteger(first / second), BigInteger(first % second)};
+  if (a.limbs.size() <= SMALLDIVIDEDIGITS) {
+    double_limb_t first = a.to_double_limb();
+    double_limb_t second = b.to_double_limb();
+    return {from_double_limb(first / second),
+            from_double_limb(first % second)};
   }
   auto c = a.shift_right(n / 2);
   auto [coeff, rem] = divide32(c, b, n / 2);
-  auto [coeff2, rem2] =
-      divide32(rem.shift_left(n / 2) +
-                   BigInteger(std::vector<long long>(
-                                  a.digit_groups.begin(),
-                                  a.digit_groups.begin() +
-                                      std::min(n / 2, a.digit_groups.size())),
-                              true),
-               b, n / 2);
+  auto [coeff2, rem2] = divide32(
+      rem.shift_left(n / 2) +
+          BigInteger(limb_vector(
+                         a.limbs.begin(),
+                         a.limbs.begin() + std::min(n / 2, a.limbs.size())),
+                     true),
+      b, n / 2);
   return {coeff.shift_left(n / 2) + coeff2, rem2};
 }
 
-// takes only positive
+// takes only positive, the divisor must be normalized
 std::pair<BigInteger, BigInteger> BigInteger::divide32(const BigInteger& a,
                                                        const BigInteger& b,
                                                        size_t n) {
   if (a < b) {
     return {BigInteger(0), a};
   }
-  if (b.digit_groups.size() <= n) {
+  if (b.limbs.size() <= n) {
     return divide21(a, b, n);
   }
-  if (a.digit_groups.size() <= SMALLDIVIDEDIGITS) {
-    long long first(a);
-    long long second(b);
-    return {BigInteger(first / second), BigInteger(first % second)};
+  if (a.limbs.size() <= SMALLDIVIDEDIGITS) {
+    double_limb_t first = a.to_double_limb();
+    double_limb_t second = b.to_double_limb();
+    return {from_double_limb(first / second),
+            from_double_limb(first % second)};
   }
 
   BigInteger coeff;
-  size_t k = b.digit_groups.size() - n;
+  size_t k = b.limbs.size() - n;
   auto a1 = a.shift_right(k);
   auto b1 = b.shift_right(k);
 
@@ -389,7 +825,8 @@ std::pair<BigInteger, BigInteger> BigInteger::divide32(const BigInteger& a,
   } else {
     coeff = divide21(a1, b1, n).first;
   }
-  auto current = a - b * coeff;
+  BigInteger current(a);
+  current.submul(b, coeff);
   while (current.is_negative()) {
     current += b;
     --coeff;
@@ -399,38 +836,372 @@ std::pair<BigInteger, BigInteger> BigInteger::divide32(const BigInteger& a,
 
 std::pair<BigInteger, BigInteger> BigInteger::divide(const BigInteger& a,
                                                      const BigInteger& b) {
-  if (compare_digit_groups(a.digit_groups, b.digit_groups) ==
-      std::strong_ordering::less) {
-    return {BigInteger(0), a};
+  return divide(BigInteger(a), b);
+}
+
+std::pair<BigInteger, BigInteger> BigInteger::divide(BigInteger&& a,
+                                                     const BigInteger& b) {
+  if (&a == &b) {
+    return divide(BigInteger(a), b);
+  }
+  if (b.is_zero()) {
+    throw std::logic_error("Division by zero");
+  }
+  if (compare_limbs(a.limbs, b.limbs) == std::strong_ordering::less) {
+    return {BigInteger(0), std::move(a)};
   }
-  size_t size = 1;
-  while (size < std::max(a.digit_groups.size(), b.digit_groups.size())) {
-    size *= 2;
+  if (b.limbs.size() >= Thresholds::current().newton_division) {
+    return divide(std::move(a), Reciprocal(b));
+  }
+  return divide_classic(std::move(a), b);
+}
+
+std::pair<BigInteger, BigInteger> BigInteger::divide_knuth(
+    BigInteger a, const BigInteger& b) {
+  size_t n = b.limbs.size();
+  if (a.limbs.size() < n) {
+    return {BigInteger(0), std::move(a)};
+  }
+  limb_vector q(a.limbs.size() - n + 1);
+  // the remainder goes to the buffer of the dividend
+  Scratch scratch(Limbs::divrem_scratch_size(a.limbs.size(), n));
+  Limbs::divrem({q.data(), q.size()}, a.mutable_limbs().first(n),
+                a.get_limbs(), b.get_limbs(), scratch);
+  a.limbs.resize(n);
+  a.fix_zero_digits();
+  return {BigInteger(std::move(q), true), std::move(a)};
+}
+
+std::pair<BigInteger, BigInteger> BigInteger::divide_classic(
+    BigInteger a, const BigInteger& b) {
+  bool quotient_positive = a.positive == b.positive;
+  bool remainder_positive = a.positive;
+  if (b.limbs.size() == 1) {
+    // the quotient is formed in place of the dividend
+    a.positive = quotient_positive;
+    limb_t rem = a.divide_limb(b.limbs[0]);
+    return {std::move(a), BigInteger(limb_vector{rem}, remainder_positive)};
+  }
+  a.positive = true;
+  std::pair<BigInteger, BigInteger> result;
+  if (b.limbs.size() < Thresholds::current().recursive_division) {
+    result = divide_knuth(std::move(a), b);
+  } else {
+    // the top bit of the divisor is made set, so that quotient estimations
+    // are off by a small constant at most
+    unsigned normalization = std::countl_zero(b.limbs.back());
+    BigInteger divisor = abs(b);
+    a.shift_bits_left(normalization);
+    divisor.shift_bits_left(normalization);
+    size_t size = 1;
+    while (size < std::max(a.limbs.size(), divisor.limbs.size())) {
+      size *= 2;
+    }
+    result = divide32(a, divisor, size);
+    result.second.shift_bits_right(normalization);
   }
-  auto [coeff, rem] = divide32(abs(a), abs(b), size);
-  coeff.positive = a.positive == b.positive;
-  rem.positive = a.positive;
+  auto& [coeff, rem] = result;
+  coeff.positive = quotient_positive;
+  rem.positive = remainder_positive;
   coeff.fix_zero_digits();
   rem.fix_zero_digits();
+  return result;
+}
+
+// Newton iteration x = x + x * (BASE^(2n) - divisor * x) / BASE^(2n),
+// started from the reciprocal of the upper half of the divisor,
+// doubles the number of correct limbs
+BigInteger BigInteger::reciprocal(const BigInteger& divisor) {
+  size_t n = divisor.limbs.size();
+  if (n < Thresholds::current().newton_reciprocal) {
+    return divide_classic(BigInteger(1).shift_left(2 * n), divisor).first;
+  }
+  size_t k = (n + 1) / 2;
+  // x = inverse * BASE^(n - k) is off by a factor of 1 + O(BASE^(-k))
+  BigInteger inverse = reciprocal(divisor.shift_right(n - k));
+  // BASE^(2n) - divisor * x = error * BASE^(n - k)
+  BigInteger error = BigInteger(1).shift_left(n + k);
+  error.submul(divisor, inverse);
+  // x * (BASE^(2n) - divisor * x) / BASE^(2n) = inverse * error / BASE^(2k),
+  // the lower limbs of the error change it by less than a unit
+  BigInteger delta = (inverse * error.shift_right(k - 1)).shift_right(k + 1);
+  BigInteger x = inverse.shift_left(n - k);
+  x += delta;
+  // now x is off by a few units, which are corrected exactly
+  BigInteger rem = error.shift_left(n - k);
+  rem.submul(divisor, delta);
+  while (rem.is_negative()) {
+    rem += divisor;
+    --x;
+  }
+  while (compare_limbs(rem.limbs, divisor.limbs) !=
+         std::strong_ordering::less) {
+    rem -= divisor;
+    ++x;
+  }
+  return x;
+}
+
+BigInteger::Reciprocal::Reciprocal(const BigInteger& divisor)
+    : divisor_(divisor), normalized(abs(divisor)) {
+  if (divisor.is_zero()) {
+    throw std::logic_error("Division by zero");
+  }
+  shift = std::countl_zero(normalized.limbs.back());
+  normalized.shift_bits_left(shift);
+  size_t n = normalized.limbs.size();
+  if (n >= Thresholds::current().barrett_division) {
+    inverse = reciprocal(normalized);
+    // the top of a partial dividend and a quotient estimate have at most
+    // n + 1 limbs
+    inverse_transform = Multiply::Prepared(inverse.limbs.data(),
+                                           inverse.limbs.size(), n + 1);
+    divisor_transform = Multiply::Prepared(normalized.limbs.data(), n, n + 1);
+  }
+}
+
+const BigInteger& BigInteger::Reciprocal::divisor() const { return divisor_; }
+
+std::pmr::memory_resource* BigInteger::get_memory_resource() const {
+  return limbs.resource();
+}
+
+std::pmr::memory_resource* BigInteger::memory_resource() {
+  std::pmr::memory_resource* resource = current_memory_resource();
+  return resource ? resource : std::pmr::new_delete_resource();
+}
+
+std::pmr::memory_resource* BigInteger::thread_pool() {
+  thread_local std::pmr::unsynchronized_pool_resource pool;
+  return &pool;
+}
+
+BigInteger::MemoryScope::MemoryScope(std::pmr::memory_resource* resource)
+    : previous(current_memory_resource()) {
+  current_memory_resource() = normalized_resource(resource);
+}
+
+BigInteger::MemoryScope::~MemoryScope() {
+  current_memory_resource() = previous;
+}
+
+BigInteger::Round::Round() : arena(thread_pool()), scope(&arena) {}
+
+BigInteger::Prepared::Prepared(const BigInteger& value)
+    : value_(value),
+      transform(value.limbs.data(), value.limbs.size(), value.limbs.size()) {}
+
+const BigInteger& BigInteger::Prepared::value() const { return value_; }
+
+std::pair<BigInteger, BigInteger> BigInteger::divide(
+    const BigInteger& a, const Reciprocal& reciprocal) {
+  return divide(BigInteger(a), reciprocal);
+}
+
+std::pair<BigInteger, BigInteger> BigInteger::divide(
+    BigInteger&& a, const Reciprocal& reciprocal) {
+  const BigInteger& b = reciprocal.divisor_;
+  if (compare_limbs(a.limbs, b.limbs) == std::strong_ordering::less) {
+    return {BigInteger(0), std::move(a)};
+  }
+  const BigInteger& divisor = reciprocal.normalized;
+  size_t n = divisor.limbs.size();
+  if (n == 1) {
+    return divide_classic(std::move(a), b);
+  }
+  bool quotient_positive = a.positive == b.positive;
+  bool remainder_positive = a.positive;
+  BigInteger dividend = std::move(a);
+  dividend.positive = true;
+  // the thresholds may have changed since the reciprocal was made
+  if (reciprocal.inverse.is_zero()) {
+    auto [coeff, rem] = divide_knuth(std::move(dividend), b);
+    coeff.positive = quotient_positive;
+    coeff.fix_zero_digits();
+    rem.positive = remainder_positive;
+    rem.fix_zero_digits();
+    return {coeff, rem};
+  }
+  dividend.shift_bits_left(reciprocal.shift);
+  // the dividend is split into blocks of n limbs, and the blocks are divided
+  // from the most significant one with the remainder carried to the next,
+  // so that every partial dividend is below divisor * BASE^n
+  size_t blocks = (dividend.limbs.size() + n - 1) / n;
+  limb_vector quotient_limbs(blocks * n);
+  BigInteger rem;
+  for (size_t i = blocks; i > 0; --i) {
+    auto block_begin = dividend.limbs.begin() + (i - 1) * n;
+    auto block_end = dividend.limbs.begin() +
+                     std::min(i * n, dividend.limbs.size());
+    BigInteger current = rem.shift_left(n);
+    current += BigInteger(limb_vector(block_begin, block_end), true);
+    // Barrett estimation, it is at most 2 less than the real quotient
+    BigInteger quotient;
+    if (current.limbs.size() >= n) {
+      const limb_vector& inverse = reciprocal.inverse.limbs;
+      size_t top_size = current.limbs.size() - (n - 1);
+      scratch_vector product(top_size + inverse.size());
+      reciprocal.inverse_transform.multiply(current.limbs.data() + (n - 1),
+                                            top_size, inverse.data(),
+                                            inverse.size(), product.data());
+      if (product.size() > n + 1) {
+        quotient = BigInteger(limb_vector(product.begin() + (n + 1),
+                                          product.end()),
+                              true);
+      }
+    }
+    if (!reciprocal.divisor_transform.is_transformed()) {
+      current.submul(quotient, divisor);
+    } else if (!quotient.is_zero()) {
+      scratch_vector product(quotient.limbs.size() + n);
+      reciprocal.divisor_transform.multiply(quotient.limbs.data(),
+                                            quotient.limbs.size(),
+                                            divisor.limbs.data(), n,
+                                            product.data());
+      if (product.back() == 0) {
+        product.pop_back();
+      }
+      // the estimate is not above the quotient, so this stays non-negative
+      current.add_with_sign(false, product.data(), product.size());
+    }
+    while (compare_limbs(current.limbs, divisor.limbs) !=
+           std::strong_ordering::less) {
+      current -= divisor;
+      ++quotient;
+    }
+    std::copy(quotient.limbs.begin(), quotient.limbs.end(),
+              quotient_limbs.begin() + (i - 1) * n);
+    rem = std::move(current);
+  }
+  BigInteger coeff(std::move(quotient_limbs), quotient_positive);
+  rem.shift_bits_right(reciprocal.shift);
+  rem.positive = remainder_positive;
+  rem.fix_zero_digits();
   return {coeff, rem};
 }
 
+size_t BigInteger::bit_length() const {
+  if (limbs.empty()) {
+    return 0;
+  }
+  return limbs.size() * LIMB_BITS - std::countl_zero(limbs.back());
+}
+
+BigInteger::limb_t BigInteger::bits_at(size_t shift) const {
+  size_t index = shift / LIMB_BITS;
+  unsigned offset = shift % LIMB_BITS;
+  if (index >= limbs.size()) {
+    return 0;
+  }
+  limb_t ans = limbs[index] >> offset;
+  if (offset != 0 && index + 1 < limbs.size()) {
+    ans |= limbs[index + 1] << (LIMB_BITS - offset);
+  }
+  return ans;
+}
+
+namespace {
+// a * x + b * y
+BigInteger combine(long long a, const BigInteger& x, long long b,
+                   const BigInteger& y) {
+  BigInteger ans = BigInteger(a) * x;
+  ans.addmul(BigInteger(b), y);
+  return ans;
+}
+}  // namespace
+
+// Lehmer's algorithm: the quotients of the euclidean algorithm mostly
+// depend only on the leading bits of the numbers, so a batch of them is
+// found on machine words, and the numbers are updated once per batch by
+// the accumulated matrix. Only the cofactor of a is kept, r0 = s0 * a
+// and r1 = s1 * a modulo b.
+std::pair<BigInteger, BigInteger> BigInteger::gcd_extended(
+    const BigInteger& a, const BigInteger& b) {
+  __extension__ typedef __int128 word_t;
+  // the leading bits are taken so that the matrix entries fit long long
+  const size_t WORD_BITS = 62;
+
+  BigInteger r0 = abs(a);
+  BigInteger r1 = abs(b);
+  BigInteger s0 = a.positive ? 1 : -1;
+  BigInteger s1 = 0;
+  if (r0 < r1) {
+    std::swap(r0, r1);
+    std::swap(s0, s1);
+  }
+  while (!r1.is_zero()) {
+    size_t bits = r0.bit_length();
+    size_t shift = bits > WORD_BITS ? bits - WORD_BITS : 0;
+    word_t x = r0.bits_at(shift);
+    word_t y = r1.bits_at(shift);
+    // the quotient of the real numbers lies between the two estimations,
+    // so it is known while they are equal (Knuth, algorithm 4.5.2L)
+    word_t m00 = 1, m01 = 0, m10 = 0, m11 = 1;
+    while (y + m10 > 0 && y + m11 > 0 && x + m00 >= 0 && x + m01 >= 0) {
+      word_t q = (x + m00) / (y + m10);
+      if (q != (x + m01) / (y + m11)) {
+        break;
+      }
+      word_t t = m00 - q * m10;
+      m00 = m10;
+      m10 = t;
+      t = m01 - q * m11;
+      m01 = m11;
+      m11 = t;
+      t = x - q * y;
+      x = y;
+      y = t;
+    }
+    if (m01 == 0) {
+      // the leading bits were not enough, a full step is made
+      auto [quot, rem] = divide(r0, r1);
+      s0.submul(quot, s1);
+      std::swap(s0, s1);
+      r0 = std::move(r1);
+      r1 = std::move(rem);
+      continue;
+    }
+    BigInteger next_r0 = combine(m00, r0, m01, r1);
+    r1 = combine(m10, r0, m11, r1);
+    r0 = std::move(next_r0);
+    BigInteger next_s0 = combine(m00, s0, m01, s1);
+    s1 = combine(m10, s0, m11, s1);
+    s0 = std::move(next_s0);
+  }
+  return {r0, s0};
+}
+
 BigInteger operator/(const BigInteger& a, const BigInteger& b) {
   return BigInteger::divide(a, b).first;
 }
 
+BigInteger operator/(BigInteger&& a, const BigInteger& b) {
+  return BigInteger::divide(std::move(a), b).first;
+}
+
 BigInteger& BigInteger::operator/=(const BigInteger& other) {
-  return *this = (*this / other);
+  return *this = divide(std::move(*this), other).first;
 }
 
 BigInteger operator%(const BigInteger& a, const BigInteger& b) {
   return BigInteger::divide(a, b).second;
 }
 
+BigInteger operator%(BigInteger&& a, const BigInteger& b) {
+  return BigInteger::divide(std::move(a), b).second;
+}
+
 BigInteger& BigInteger::operator%=(const BigInteger& other) {
-  return *this = (*this % other);
+  return *this = divide(std::move(*this), other).second;
 }
 
 BigInteger operator-(const BigInteger& a) {
-  return BigInteger(a.digit_groups, !a.positive);
+  return BigInteger(a.limbs, !a.positive);
+}
+
+BigInteger operator-(BigInteger&& a) {
+  if (!a.is_zero()) {
+    a.positive ^= 1;
+  }
+  return std::move(a);
 }
@@ -3,18 +3,40 @@
 #include <algorithm>
 #include <cmath>
 #include <compare>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "multiply.hpp"
+#include "small_vector.hpp"
+
+// number of limbs a BigInteger keeps without heap allocation
+#ifndef BIGINT_INLINE_LIMBS
+#define BIGINT_INLINE_LIMBS 8
+#endif
+
 using namespace std;
 
+template <typename Value>
+class BasicModuledBigInt;
+
 class BigInteger {
  public:
-  BigInteger();
+  constexpr BigInteger() : positive(true) {}
   explicit BigInteger(const std::string&);
-  BigInteger(long long);
+  constexpr BigInteger(long long number) : positive(number >= 0) {
+    limb_t magnitude = positive ? limb_t(number) : -limb_t(number);
+    if (magnitude != 0) {
+      limbs.emplace_back(magnitude);
+    }
+  }
   BigInteger(const BigInteger&) = default;
   BigInteger(BigInteger&&);
+  // a copy with the limbs in the given resource
+  BigInteger(const BigInteger&, std::pmr::memory_resource*);
 
   BigInteger& operator=(const BigInteger&) = default;
   BigInteger& operator=(BigInteger&&);
@@ -34,9 +56,43 @@ class BigInteger {
   BigInteger& operator/=(const BigInteger&);
   BigInteger& operator%=(const BigInteger&);
 
+  // this * this, faster than the general multiplication
+  BigInteger square() const;
+
+  // this += a * b and this -= a * b without temporary BigIntegers
+  BigInteger& addmul(const BigInteger& a, const BigInteger& b);
+  BigInteger& submul(const BigInteger& a, const BigInteger& b);
+  // a * b + c
+  static BigInteger mul_add(const BigInteger& a, const BigInteger& b,
+                            const BigInteger& c);
+
+  class Reciprocal;
+  class Prepared;
+
+  // products with a number prepared for them
+  BigInteger& operator*=(const Prepared&);
+  friend BigInteger operator*(const BigInteger&, const Prepared&);
+  friend BigInteger operator*(BigInteger&&, const Prepared&);
+
   // quotient, remainder
   static std::pair<BigInteger, BigInteger> divide(const BigInteger&,
                                                   const BigInteger&);
+  static std::pair<BigInteger, BigInteger> divide(const BigInteger&,
+                                                  const Reciprocal&);
+  // these reuse the buffer of the dividend
+  static std::pair<BigInteger, BigInteger> divide(BigInteger&&,
+                                                  const BigInteger&);
+  static std::pair<BigInteger, BigInteger> divide(BigInteger&&,
+                                                  const Reciprocal&);
+
+  // base^exponent modulo the divisor by sliding windows, in [0, |divisor|);
+  // throws std::domain_error for a negative exponent
+  static BigInteger pow_mod(const BigInteger& base, const BigInteger& exponent,
+                            const Reciprocal& modulus);
+
+  // gcd(|a|, |b|) and x such that a * x = gcd modulo b, x is not reduced
+  static std::pair<BigInteger, BigInteger> gcd_extended(const BigInteger& a,
+                                                        const BigInteger& b);
 
   friend BigInteger operator+(const BigInteger&, const BigInteger&);
   friend BigInteger operator-(const BigInteger&, const BigInteger&);
@@ -44,12 +100,70 @@ class BigInteger {
   friend BigInteger operator/(const BigInteger&, const BigInteger&);
   friend BigInteger operator%(const BigInteger&, const BigInteger&);
   friend BigInteger operator-(const BigInteger&);
+  friend BigInteger pow(const BigInteger& base, unsigned long long exponent);
+
+  // the result takes the buffer of an rvalue operand
+  friend BigInteger operator+(BigInteger&&, const BigInteger&);
+  friend BigInteger operator+(const BigInteger&, BigInteger&&);
+  friend BigInteger operator+(BigInteger&&, BigInteger&&);
+  friend BigInteger operator-(BigInteger&&, const BigInteger&);
+  friend BigInteger operator-(const BigInteger&, BigInteger&&);
+  friend BigInteger operator-(BigInteger&&, BigInteger&&);
+  friend BigInteger operator*(BigInteger&&, const BigInteger&);
+  friend BigInteger operator*(const BigInteger&, BigInteger&&);
+  friend BigInteger operator*(BigInteger&&, BigInteger&&);
+  friend BigInteger operator/(BigInteger&&, const BigInteger&);
+  friend BigInteger operator%(BigInteger&&, const BigInteger&);
+  friend BigInteger operator-(BigInteger&&);
 
   BigInteger& operator++();
   BigInteger& operator--();
   BigInteger operator++(int);
   BigInteger operator--(int);
 
+  enum class ByteOrder { kBigEndian, kLittleEndian };
+
+  // number of bytes in |this|, 0 for zero
+  size_t byte_length() const;
+  // non-negative numbers in exactly that many bytes, padded with zeros,
+  // throw std::length_error if the number does not fit
+  std::vector<uint8_t> to_bytes(size_t size,
+                                ByteOrder = ByteOrder::kBigEndian) const;
+  void to_bytes(std::span<uint8_t> out,
+                ByteOrder = ByteOrder::kBigEndian) const;
+  static BigInteger from_bytes(std::span<const uint8_t>,
+                               ByteOrder = ByteOrder::kBigEndian);
+
+  // variable width: a 4-byte big-endian header with twice the byte length,
+  // plus one for negative numbers, then the big-endian magnitude
+  size_t prefixed_size() const;
+  std::vector<uint8_t> to_prefixed_bytes() const;
+  // out must have at least prefixed_size() bytes, returns the bytes written
+  size_t to_prefixed_bytes(std::span<uint8_t> out) const;
+  // the number and the bytes read, in may continue after it
+  static std::pair<BigInteger, size_t> from_prefixed_bytes(
+      std::span<const uint8_t> in);
+
+  // Long numbers take their limbs from the memory resource that is current
+  // on the thread when they are created and keep it for their whole life,
+  // assignments copy the value into the resource of the target. Outside of
+  // a MemoryScope it is the heap, std::pmr::new_delete_resource().
+  std::pmr::memory_resource* get_memory_resource() const;
+  static std::pmr::memory_resource* memory_resource();
+  class MemoryScope;
+  class Round;
+  // the pool of the calling thread, numbers from it must be destroyed on the
+  // same thread before it ends
+  static std::pmr::memory_resource* thread_pool();
+
+  // |this| as limbs, least significant first, without leading zeros
+  constexpr std::span<const uint64_t> get_limbs() const {
+    return {limbs.data(), limbs.size()};
+  }
+  // leading zero limbs are allowed
+  static BigInteger from_limbs(std::span<const uint64_t>,
+                               bool negative = false);
+
   friend std::istream& operator>>(std::istream&, BigInteger&);
   friend std::ostream& operator<<(std::ostream&, const BigInteger&);
 
@@ -60,26 +174,204 @@ class BigInteger {
   friend BigInteger abs(const BigInteger&);
 
  private:
+  // ModuledBigInt works on the limbs of its value directly
+  friend class BasicModuledBigInt<BigInteger>;
+
+  using limb_t = uint64_t;
+  __extension__ typedef unsigned __int128 double_limb_t;
+  using limb_vector = SmallVector<limb_t, BIGINT_INLINE_LIMBS>;
+  // temporary products, large enough to hold a square of an inline number
+  using scratch_vector = SmallVector<limb_t, 4 * BIGINT_INLINE_LIMBS>;
+
   void fix_zero_digits();
-  static std::strong_ordering compare_digit_groups(
-      const std::vector<long long>&, const std::vector<long long>&);
-  void add_with_sign(bool, const std::vector<long long>&);
-  BigInteger(const std::vector<long long>&, bool);
-  BigInteger(std::vector<long long>&&, bool);
+  std::span<limb_t> mutable_limbs() { return {limbs.data(), limbs.size()}; }
+  // a per-thread buffer for products, swapped with the limbs of the result
+  static limb_vector& spare_limbs();
+  // this *= other, with the transform of other if there is one
+  BigInteger& multiply_by(const BigInteger& other,
+                          const Multiply::Prepared* transform);
+  // larger spare buffers are freed, allocating them is cheap next to
+  // the multiplication
+  static const size_t SPARE_LIMBS_LIMIT = 8192;
+  // the scratch space of a Limbs call in a per-thread buffer, which is kept
+  // for the next calls up to SPARE_LIMBS_LIMIT limbs; a call nested in one
+  // that holds the buffer gets space of its own
+  class Scratch;
+  static std::strong_ordering compare_limbs(const limb_vector&,
+                                            const limb_vector&);
+  static std::strong_ordering compare_limbs(const limb_t*, size_t,
+                                            const limb_t*, size_t);
+  // this = |this| +- |other| with the sign of this
+  void add_with_sign(bool same_sign, const limb_t* other, size_t other_size);
+  BigInteger(const limb_vector&, bool);
+  // a non-negative number from limbs without leading zeros, for literals
+  constexpr BigInteger(const limb_t* first, const limb_t* last)
+      : limbs(first, last), positive(true) {}
+  template <char... Digits>
+  friend constexpr BigInteger operator""_bi();
+  BigInteger(limb_vector&&, bool);
+  static BigInteger from_double_limb(double_limb_t);
+  double_limb_t to_double_limb() const;
   void add_one_with_sign(bool);
+  // this = this + a * b or this - a * b
+  void add_product(bool subtract, const BigInteger& a, const BigInteger& b);
+  // this = this * multiplier + addend, ignores the sign
+  void multiply_add_limb(limb_t multiplier, limb_t addend);
+  // this = this / divisor, returns the remainder, ignores the sign
+  limb_t divide_limb(limb_t divisor);
+  size_t bit_length() const;
+  // |this| in out, which must be large enough
+  void store_magnitude(std::span<uint8_t> out, bool big_endian) const;
+  // bits [shift, shift + LIMB_BITS) of |this|
+  limb_t bits_at(size_t shift) const;
   BigInteger shift_left(size_t) const;
   BigInteger shift_right(size_t) const;
+  void shift_bits_left(unsigned);
+  void shift_bits_right(unsigned);
   static std::pair<BigInteger, BigInteger> divide32(const BigInteger&,
                                                     const BigInteger&, size_t);
   static std::pair<BigInteger, BigInteger> divide21(const BigInteger&,
                                                     const BigInteger&, size_t);
-  static const size_t SMALLDIVIDEDIGITS = 3;
+  // the long division of the magnitudes by Limbs::divrem, the results are
+  // non-negative
+  static std::pair<BigInteger, BigInteger> divide_knuth(BigInteger,
+                                                        const BigInteger&);
+  static std::pair<BigInteger, BigInteger> divide_classic(BigInteger,
+                                                          const BigInteger&);
+  // floor(BASE^(2n) / divisor) for a normalized divisor of n limbs
+  static BigInteger reciprocal(const BigInteger& divisor);
+  // the base case of the recursive division, which divides double limbs;
+  // the sizes at which the divisions switch are in Thresholds::current()
+  static const size_t SMALLDIVIDEDIGITS = 2;
+
+  static const size_t LIMB_BITS = 64;
+  static const size_t PREFIX_BYTES = 4;
+  // decimal conversion is done in blocks of DECIMAL_BASELEN digits
+  static const limb_t DECIMAL_BASE = 10'000'000'000'000'000'000ull;
+  static const size_t DECIMAL_BASELEN = 19;
+  // numbers of at least that many limbs are converted by halves
+  static const size_t DECIMAL_CONVERSION_THRESHOLD = 64;
 
-  static const long long BASE = 100'000;
-  static const size_t BASELEN = 5;
+  // DECIMAL_BASE^(2^level), cached per thread
+  static const Reciprocal& decimal_power(size_t level);
+  // takes only digits
+  static BigInteger from_decimal(const char* digits, size_t length);
+  // appends the digits of |this|, padded with zeros to width
+  void to_decimal(std::string& out, size_t width) const;
 
-  std::vector<long long> digit_groups;
+  limb_vector limbs;
   bool positive;
 };
 
-BigInteger operator""_bi(const char*);
\ No newline at end of file
+/*
+ * Divisor with its precomputed reciprocal. Division by it costs a couple of
+ * multiplications of the divisor size, so it is worth keeping one for a
+ * number that is divided by many times, like a modulus. Short divisors are
+ * divided by the long division, which is faster for them.
+ */
+class BigInteger::Reciprocal {
+ public:
+  explicit Reciprocal(const BigInteger& divisor);
+
+  const BigInteger& divisor() const;
+
+ private:
+  friend class BigInteger;
+
+  BigInteger divisor_;
+  // |divisor| shifted left until the top bit of the last limb is set
+  BigInteger normalized;
+  unsigned shift;
+  // floor(BASE^(2n) / normalized), n is the number of limbs in normalized,
+  // only for divisors of at least Thresholds::barrett_division limbs when
+  // it is made, zero otherwise
+  BigInteger inverse;
+  // transforms of inverse and normalized for the products of every division
+  Multiply::Prepared inverse_transform;
+  Multiply::Prepared divisor_transform;
+};
+
+/*
+ * Makes a memory resource current on this thread while it exists, nullptr
+ * for the heap; scopes nest. Caches that outlive the scope must not be
+ * created inside it.
+ */
+class BigInteger::MemoryScope {
+ public:
+  explicit MemoryScope(std::pmr::memory_resource*);
+  MemoryScope(const MemoryScope&) = delete;
+  MemoryScope& operator=(const MemoryScope&) = delete;
+  ~MemoryScope();
+
+ private:
+  std::pmr::memory_resource* previous;
+};
+
+/*
+ * Monotonic arena for the temporaries of one round, like a response of the
+ * protocol. The numbers created on the thread while it exists take their
+ * limbs from it without freeing them one by one, and all of them go back to
+ * the thread pool at once when it ends. The numbers that outlive the round
+ * must be created before it, results are assigned to them.
+ */
+class BigInteger::Round {
+ public:
+  Round();
+
+ private:
+  std::pmr::monotonic_buffer_resource arena;
+  MemoryScope scope;
+};
+
+/*
+ * Number that is multiplied by many times, like a key. A long number keeps
+ * the forward transform of the multiplication, so that the products with
+ * it transform only the other operand. It fits operands up to its own
+ * length, longer ones are multiplied the usual way.
+ */
+class BigInteger::Prepared {
+ public:
+  explicit Prepared(const BigInteger& value);
+
+  const BigInteger& value() const;
+
+ private:
+  friend class BigInteger;
+  friend BigInteger operator*(const BigInteger&, const Prepared&);
+
+  BigInteger value_;
+  Multiply::Prepared transform;
+};
+
+BigInteger pow(const BigInteger& base, unsigned long long exponent);
+
+/*
+ * Decimal literal like 1791791791_bi, parsed at compile time, so numbers
+ * that fit into the inline limbs can be constexpr. Digits may be separated
+ * by apostrophes.
+ */
+template <char... Digits>
+constexpr BigInteger operator""_bi() {
+  static_assert(((Digits == '\'' || (Digits >= '0' && Digits <= '9')) && ...),
+                "BigInteger literals must be decimal");
+  __extension__ typedef unsigned __int128 double_limb_t;
+  constexpr char digits[] = {Digits...};
+  // a decimal digit takes less than 4 bits
+  uint64_t limbs[(sizeof...(Digits) * 4 + 63) / 64] = {};
+  size_t size = 0;
+  for (char digit : digits) {
+    if (digit == '\'') {
+      continue;
+    }
+    double_limb_t carry = digit - '0';
+    for (size_t i = 0; i < size; ++i) {
+      carry += double_limb_t(limbs[i]) * 10;
+      limbs[i] = uint64_t(carry);
+      carry >>= 64;
+    }
+    if (carry != 0) {
+      limbs[size++] = uint64_t(carry);
+    }
+  }
+  return BigInteger(limbs, limbs + size);
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+/*
+ * Exponentiation by sliding windows over exponents given as limbs, least
+ * significant first. The values are of any type T with the products and
+ * squares passed as functions, so that the same code serves residues
+ * modulo N and modulo a Reciprocal.
+ */
+namespace Exponent {
+inline bool bit(std::span<const uint64_t> limbs, size_t index) {
+  return index / 64 < limbs.size() && (limbs[index / 64] >> index % 64) & 1;
+}
+
+inline size_t bit_length(std::span<const uint64_t> limbs) {
+  size_t size = limbs.size();
+  while (size > 0 && limbs[size - 1] == 0) {
+    --size;
+  }
+  if (size == 0) {
+    return 0;
+  }
+  return size * 64 - __builtin_clzll(limbs[size - 1]);
+}
+
+// the window width that minimizes the multiplications for an exponent of
+// that many bits, counting the table of odd powers
+inline unsigned window_bits(size_t bits) {
+  const size_t LIMITS[] = {7, 23, 79, 239, 671};
+  unsigned width = 1;
+  for (size_t limit : LIMITS) {
+    width += bits > limit;
+  }
+  return width;
+}
+
+// the longest window of at most width bits that starts at the set bit
+// top - 1 and ends with a set bit, as its value and its length
+inline std::pair<unsigned, unsigned> window(std::span<const uint64_t> limbs,
+                                            size_t top, unsigned width) {
+  unsigned length = std::min<size_t>(width, top);
+  while (!bit(limbs, top - length)) {
+    --length;
+  }
+  unsigned value = 0;
+  for (unsigned i = 1; i <= length; ++i) {
+    value = (value << 1) | bit(limbs, top - i);
+  }
+  return {value, length};
+}
+
+// base^1, base^3, ..., base^(2^width - 1)
+template <typename T, typename Multiply, typename Square>
+std::vector<T> odd_powers(const T& base, unsigned width, Multiply multiply,
+                          Square square) {
+  std::vector<T> table = {base};
+  if (width > 1) {
+    T squared = square(base);
+    for (size_t i = 1; i < size_t(1) << (width - 1); ++i) {
+      table.push_back(multiply(table.back(), squared));
+    }
+  }
+  return table;
+}
+
+// base^exponent, one is returned for a zero exponent
+template <typename T, typename Multiply, typename Square>
+T sliding_window(const T& base, std::span<const uint64_t> exponent,
+                 const T& one, Multiply multiply, Square square) {
+  size_t bits = bit_length(exponent);
+  if (bits == 0) {
+    return one;
+  }
+  auto table = odd_powers(base, window_bits(bits), multiply, square);
+  // the top bit is set, so the first step is a window
+  T result = one;
+  for (size_t top = bits; top > 0;) {
+    if (!bit(exponent, top - 1)) {
+      result = square(result);
+      --top;
+      continue;
+    }
+    auto [value, length] = window(exponent, top, window_bits(bits));
+    if (top == bits) {
+      result = table[value / 2];
+    } else {
+      for (unsigned i = 0; i < length; ++i) {
+        result = square(result);
+      }
+      result = multiply(result, table[value / 2]);
+    }
+    top -= length;
+  }
+  return result;
+}
+
+/*
+ * The product of bases[i]^exponents[i] by Straus' method: every base has
+ * its own table and windows, and the squarings are shared, so the product
+ * of k powers costs about as many squarings as a single one. Shamir's trick
+ * is the case of two bases.
+ */
+template <typename T, typename Multiply, typename Square>
+T interleaved(std::span<const T> bases,
+              const std::vector<std::span<const uint64_t>>& exponents,
+              const T& one, Multiply multiply, Square square) {
+  // the products by table entries due at every bit position
+  struct Step {
+    size_t base;
+    unsigned index;
+  };
+  size_t bits = 0;
+  for (auto exponent : exponents) {
+    bits = std::max(bits, bit_length(exponent));
+  }
+  std::vector<std::vector<Step>> steps(bits);
+  std::vector<std::vector<T>> tables(bases.size());
+  for (size_t i = 0; i < bases.size(); ++i) {
+    size_t top = bit_length(exponents[i]);
+    unsigned width = window_bits(top);
+    if (top != 0) {
+      tables[i] = odd_powers(bases[i], width, multiply, square);
+    }
+    while (top > 0) {
+      if (!bit(exponents[i], top - 1)) {
+        --top;
+        continue;
+      }
+      auto [value, length] = window(exponents[i], top, width);
+      top -= length;
+      steps[top].push_back({i, value / 2});
+    }
+  }
+  T result = one;
+  bool started = false;
+  for (size_t position = bits; position > 0; --position) {
+    if (started) {
+      result = square(result);
+    }
+    for (auto step : steps[position - 1]) {
+      const T& power = tables[step.base][step.index];
+      result = started ? multiply(result, power) : power;
+      started = true;
+    }
+  }
+  return result;
+}
+}  // namespace Exponent
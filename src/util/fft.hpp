@@ -1,149 +1,422 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace FFT {
-template <typename T>
-struct complex {
-  T x, y;
+// pi to more digits than long double holds
+const long double PI = 3.141592653589793238462643383279502884L;
 
-  complex() : x(0), y(0) {}
-  complex(T x, T y) : x(x), y(y) {}
+struct RootsLevel {
+  const double *re;
+  const double *im;
+};
 
-  complex operator*(const complex &c) const {
-    return complex(x * c.x - y * c.y, x * c.y + y * c.x);
-  }
+// e^(i * PI * j / len) for j < len, len = 2^level, computed in long double
+// and rounded. Every level is computed once by the first thread that needs
+// it and is never changed afterwards, so concurrent transforms share the
+// tables without locking.
+inline RootsLevel roots_level(int level) {
+  static constexpr int LEVELS = 31;
+  static std::once_flag computed[LEVELS];
+  static std::unique_ptr<double[]> re[LEVELS];
+  static std::unique_ptr<double[]> im[LEVELS];
 
-  complex operator+(const complex &c) const {
-    return complex(x + c.x, y + c.y);
-  }
+  std::call_once(computed[level], [level] {
+    size_t len = size_t(1) << level;
+    re[level] = std::make_unique<double[]>(len);
+    im[level] = std::make_unique<double[]>(len);
+    for (size_t i = 0; i < len; i++) {
+      long double angle = PI * i / len;
+      re[level][i] = double(cosl(angle));
+      im[level][i] = double(sinl(angle));
+    }
+  });
+  return {re[level].get(), im[level].get()};
+}
 
-  complex operator-(const complex &c) const {
-    return complex(x - c.x, y - c.y);
-  }
+/*
+ * Convolutions in double precision. The transforms work on separate arrays
+ * of real and imaginary parts, so that the butterflies vectorize. As in the
+ * NTT, the forward transform leaves the result in bit-reversed order and
+ * the inverse one takes it in that order, so there is no permutation.
+ *
+ * By theorem 5.1 of C. Percival, "Rapid multiplication modulo the sum and
+ * difference of highly composite numbers" (2003), every coefficient of
+ * x * y computed this way with transforms of size 2^k is off by less than
+ * |x| * |y| * ((1 + e)^3k (1 + e sqrt(5))^(3k + 1) (1 + b)^3k - 1),
+ * where |x| is the euclidean norm, e = 2^-53 is the unit roundoff and
+ * b bounds the error of the roots. Rounding the long double roots gives
+ * b < 2^-53 + 2^-63, and 2^-52 is used.
+ *
+ * The products transform real sequences, so they use the symmetry of the
+ * spectrum of a real sequence, X(-k) = conj(X(k)). Two operands a and b go
+ * into one transform as a + ib, and the spectrum of their product is
+ * (Z(k)^2 - conj(Z(-k))^2) / 4i. A single operand of size 2n and the real
+ * product are transformed at size n as the complex sequences of their
+ * even and odd coefficients, with one more step that splits or joins the
+ * two halves of the spectrum.
+ */
+const double UNIT_ROUNDOFF = 0x1p-53;
+const double ROOTS_ERROR = 0x1p-52;
+// narrower pieces than that make the transform too long to be worth it
+const unsigned MIN_PIECE_BITS = 8;
+const unsigned MAX_PIECE_BITS = 24;
 
-  template <typename value_t>
-  complex operator/(const value_t &value) const {
-    return complex(x / value, y / value);
+inline double error_bound(double x_norm, double y_norm, size_t size) {
+  double k = std::log2(double(size));
+  double relative =
+      std::expm1(3 * k * std::log1p(UNIT_ROUNDOFF) +
+                 (3 * k + 1) * std::log1p(UNIT_ROUNDOFF * std::sqrt(5.0)) +
+                 3 * k * std::log1p(ROOTS_ERROR));
+  return x_norm * y_norm * relative;
+}
+
+inline size_t transform_size(size_t real_size) {
+  size_t size = 1;
+  while (size < real_size) size <<= 1;
+  return size;
+}
+
+// The bound for the products below with transforms of the given size. The
+// spectrum of the product of a and b packed as a + ib is a quarter of the
+// difference of two squares of a + ib, so its error is that of the product
+// of two operands of norm sqrt((|a|^2 + |b|^2) / 2); that is |a| for a
+// square and at least sqrt(|a| |b|) otherwise. The split and join steps of
+// the half-size transforms are a level of butterflies each, and the bound
+// is taken for a transform twice as long to cover them.
+inline double product_error_bound(double a_norm, double b_norm, size_t size) {
+  double norm = std::sqrt((a_norm * a_norm + b_norm * b_norm) / 2);
+  return error_bound(norm, norm, 2 * size);
+}
+
+// the widest pieces for which the product of numbers of a_bits and b_bits
+// bits split into such pieces is exact, 0 if there are none
+inline unsigned piece_bits(size_t a_bits, size_t b_bits) {
+  for (unsigned bits = MAX_PIECE_BITS; bits >= MIN_PIECE_BITS; --bits) {
+    size_t a_pieces = (a_bits + bits - 1) / bits;
+    size_t b_pieces = (b_bits + bits - 1) / bits;
+    double piece = std::ldexp(1.0, bits) - 1;
+    if (product_error_bound(std::sqrt(double(a_pieces)) * piece,
+                            std::sqrt(double(b_pieces)) * piece,
+                            transform_size(a_pieces + b_pieces - 1)) < 0.5) {
+      return bits;
+    }
   }
+  return 0;
+}
 
-  complex conj() const { return complex(x, -y); }
-};
+// two doubles processed at once, which every x86-64 processor has vector
+// registers for; GCC does not vectorize the loops by itself at -O2
+typedef double double2 __attribute__((vector_size(16)));
 
-template <typename float_t = long double>
-void fft(std::vector<complex<float_t>> &a) {
-  static std::vector<int> reversed_mask;
-  static std::vector<complex<float_t>> roots = std::vector<complex<float_t>>(1);
-  static constexpr float_t PI = M_PI;
+template <typename T>
+inline T load(const double *from) {
+  T value;
+  std::memcpy(&value, from, sizeof(T));
+  return value;
+}
 
-  if (a.empty()) return;
+template <typename T>
+inline void store(double *to, T value) {
+  std::memcpy(to, &value, sizeof(T));
+}
 
-  int n = int(a.size());
-  // assert((n & (n - 1)) == 0);
+// one layer of butterflies of the given length, T is double or double2
+template <typename T>
+inline void forward_layer(double *re, double *im, size_t size, size_t len,
+                          RootsLevel roots) {
+  for (size_t i = 0; i < size; i += (len << 1))
+    for (size_t j = 0; j < len; j += sizeof(T) / sizeof(double)) {
+      T u_re = load<T>(re + i + j), u_im = load<T>(im + i + j);
+      T v_re = load<T>(re + i + j + len), v_im = load<T>(im + i + j + len);
+      T w_re = load<T>(roots.re + j), w_im = load<T>(roots.im + j);
+      T d_re = u_re - v_re, d_im = u_im - v_im;
+      store(re + i + j, u_re + v_re);
+      store(im + i + j, u_im + v_im);
+      store(re + i + j + len, d_re * w_re - d_im * w_im);
+      store(im + i + j + len, d_re * w_im + d_im * w_re);
+    }
+}
 
-  if (int(reversed_mask.size()) != n) {
-    int lg = 0;
-    {
-      auto copy = n;
-      while (copy > 1) {
-        lg++;
-        copy /= 2;
-      }
+template <typename T>
+inline void inverse_layer(double *re, double *im, size_t size, size_t len,
+                          RootsLevel roots) {
+  for (size_t i = 0; i < size; i += (len << 1))
+    for (size_t j = 0; j < len; j += sizeof(T) / sizeof(double)) {
+      T u_re = load<T>(re + i + j), u_im = load<T>(im + i + j);
+      T v_re = load<T>(re + i + j + len), v_im = load<T>(im + i + j + len);
+      T w_re = load<T>(roots.re + j), w_im = load<T>(roots.im + j);
+      T t_re = v_re * w_re + v_im * w_im;
+      T t_im = v_im * w_re - v_re * w_im;
+      store(re + i + j, u_re + t_re);
+      store(im + i + j, u_im + t_im);
+      store(re + i + j + len, u_re - t_re);
+      store(im + i + j + len, u_im - t_im);
     }
-    //__lg(n)
-    reversed_mask.resize(n);
-    for (int mask = 1; mask < n; mask++)
-      reversed_mask[mask] =
-          (reversed_mask[mask >> 1] >> 1) + ((mask & 1) << (lg - 1));
-  }
+}
 
-  if (int(roots.size()) < n) {
-    int prev_size = roots.size();
-    roots.resize(n);
-    for (int len = prev_size; len < n; len <<= 1)
-      for (int i = 0; i < len; i++)
-        roots[len + i] =
-            complex<float_t>(cosl(PI * i / len), sinl(PI * i / len));
+// a = a * b / size pointwise, dividing by a power of two is exact
+template <typename T>
+inline void multiply_scaled(double *a_re, double *a_im, const double *b_re,
+                            const double *b_im, size_t size) {
+  T scale = T{} + 1.0 / double(size);
+  for (size_t i = 0; i < size; i += sizeof(T) / sizeof(double)) {
+    T x_re = load<T>(a_re + i), x_im = load<T>(a_im + i);
+    T y_re = load<T>(b_re + i), y_im = load<T>(b_im + i);
+    store(a_re + i, (x_re * y_re - x_im * y_im) * scale);
+    store(a_im + i, (x_re * y_im + x_im * y_re) * scale);
   }
+}
 
-  auto cp = reversed_mask;
-  for (int i = 0; i < n; i++) {
-    if (i < reversed_mask[i]) std::swap(a[i], a[reversed_mask[i]]);
-  }
+const size_t VECTOR_LANES = sizeof(double2) / sizeof(double);
 
-  for (int len = 1; len < n; len <<= 1)
-    for (int i = 0; i < n; i += (len << 1))
-      for (int j = 0; j < len; j++) {
-        complex<float_t> value = a[i + j + len] * roots[len + j];
-        a[i + j + len] = a[i + j] - value;
-        a[i + j] = a[i + j] + value;
+inline void multiply_scaled(double *a_re, double *a_im, const double *b_re,
+                            const double *b_im, size_t size) {
+  if (size >= VECTOR_LANES)
+    multiply_scaled<double2>(a_re, a_im, b_re, b_im, size);
+  else
+    multiply_scaled<double>(a_re, a_im, b_re, b_im, size);
+}
+
+// Calls visit(t, u, k) for the positions t of a transform of the given
+// size in bit-reversed order that hold the coefficients k <= size / 2, with
+// u the position of the coefficient size - k, which is t for k = 0 and
+// k = size / 2. The positions from s to 2s - 1 hold the odd multiples of
+// size / 2s and mirror each other, t + u = 3s - 1. The blocks of them go
+// in ascending order, or in descending order if it is said so.
+template <typename Visit>
+inline void for_conjugate_pairs(size_t size, bool descending, Visit visit) {
+  auto block = [size, &visit](size_t s) {
+    size_t step = size / s;
+    // q reversed in log2(s) bits
+    size_t reversed = 0;
+    for (size_t q = 0; q < std::max<size_t>(s / 2, 1); q++) {
+      visit(s + q, 2 * s - 1 - q, step * reversed + step / 2);
+      size_t bit = s >> 1;
+      while (reversed & bit) {
+        reversed ^= bit;
+        bit >>= 1;
       }
+      reversed |= bit;
+    }
+  };
+  if (descending) {
+    for (size_t s = size >> 1; s >= 1; s >>= 1) block(s);
+    visit(0, 0, 0);
+  } else {
+    visit(0, 0, 0);
+    for (size_t s = 1; s < size; s <<= 1) block(s);
+  }
 }
 
-template <typename result_t, typename float_t = long double, typename T1,
-          typename T2>
-std::vector<result_t> multiply_poly(T1 a_begin, T1 a_end, T2 b_begin,
-                                    T2 b_end) {
-  static constexpr float_t PI = M_PI;
+/*
+ * Transforms of one size with the root tables of its levels and the array
+ * of an operand. Plans are cached per thread by cached_plan, so that
+ * repeated products of the same sizes neither look the tables up nor
+ * allocate. A plan of size 2n also makes the transforms of size n of real
+ * sequences of size 2n.
+ */
+class Plan {
+ public:
+  explicit Plan(size_t size) : size_(size), workspace(2 * size) {
+    assert(size >= 2);
+    for (size_t len = 1, level = 0; len < size; len <<= 1, level++)
+      roots.push_back(roots_level(int(level)));
+  }
+
+  size_t size() const { return size_; }
 
-  if (a_begin == a_end || b_begin == b_end) return {};
+  // real and imaginary parts of the operand
+  double *re() { return workspace.data(); }
+  double *im() { return workspace.data() + size_; }
 
-  static constexpr int BUBEN = 20;
-  int n = std::distance(a_begin, a_end);
-  int m = std::distance(b_begin, b_end);
-  if (std::min(n, m) <= BUBEN) {
-    vector<result_t> product(n + m - 1);
-    for (int i = 0; a_begin != a_end; i++, a_begin++) {
-      T2 iterator = b_begin;
-      for (int j = 0; iterator != b_end; j++, iterator++)
-        product[i + j] += result_t(*a_begin) * result_t(*iterator);
+  // decimation in frequency, leaves the result in bit-reversed order; the
+  // size is a power of two up to the size of the plan
+  void forward(double *re, double *im, size_t size) const {
+    for (size_t len = size >> 1, level = std::countr_zero(size); len >= 1;
+         len >>= 1) {
+      level--;
+      if (len >= VECTOR_LANES)
+        forward_layer<double2>(re, im, size, len, roots[level]);
+      else
+        forward_layer<double>(re, im, size, len, roots[level]);
     }
-    return product;
   }
 
-  int real_size = n + m - 1;
-  int base = 2;
-  while (base < real_size) base <<= 1;
-
-  std::vector<complex<float_t>> res(base);
-  for (int i = 0; a_begin != a_end; i++, a_begin++) res[i].x = *a_begin;
-
-  for (int i = 0; b_begin != b_end; i++, b_begin++) res[i].y = *b_begin;
+  // decimation in time with the conjugate roots, takes the bit-reversed
+  // order, the result is multiplied by the size
+  void inverse(double *re, double *im, size_t size) const {
+    for (size_t len = 1, level = 0; len < size; len <<= 1, level++) {
+      if (len >= VECTOR_LANES)
+        inverse_layer<double2>(re, im, size, len, roots[level]);
+      else
+        inverse_layer<double>(re, im, size, len, roots[level]);
+    }
+  }
 
-  fft<float_t>(res);
-  complex<float_t> coeff(0, float_t(-0.25) / base);
-  for (int i = 0; i <= (base >> 1); i++) {
-    int j = (base - i) & (base - 1);
-    complex<float_t> num = (res[j] * res[j] - (res[i] * res[i]).conj()) * coeff;
-    res[j] = (res[i] * res[i] - (res[j] * res[j]).conj()) * coeff;
-    res[i] = num;
+  // The spectrum of the real sequence of a_size values in re(), by the
+  // transform of size / 2 of its even and odd values as complex numbers.
+  // The spectrum is left in re() and im() in the bit-reversed order of
+  // the full size.
+  void forward_real(size_t a_size) {
+    double *re = this->re(), *im = this->im();
+    size_t half = size_ >> 1;
+    std::fill(re + a_size, re + size_, 0.0);
+    for (size_t j = 0; j < half; j++) {
+      double even = re[2 * j], odd = re[2 * j + 1];
+      re[j] = even;
+      im[j] = odd;
+    }
+    forward(re, im, half);
+    // the transform y of size n gives the transforms e and o of the even
+    // and odd values, x(k) = e(k) + w^k o(k) and x(k + n) = e(k) - w^k o(k),
+    // which are at the positions 2t and 2t + 1 for y(k) at t; the blocks
+    // go down, as every one of them is written over the next one
+    RootsLevel w = roots.back();
+    for_conjugate_pairs(half, true, [&](size_t t, size_t u, size_t k) {
+      double e_re = (re[t] + re[u]) * 0.5, e_im = (im[t] - im[u]) * 0.5;
+      double o_re = (im[t] + im[u]) * 0.5, o_im = (re[u] - re[t]) * 0.5;
+      double wo_re = o_re * w.re[k] - o_im * w.im[k];
+      double wo_im = o_re * w.im[k] + o_im * w.re[k];
+      re[2 * t] = e_re + wo_re;
+      im[2 * t] = e_im + wo_im;
+      re[2 * t + 1] = e_re - wo_re;
+      im[2 * t + 1] = e_im - wo_im;
+      if (u != t) {
+        // x(n - k) = conj(x(n + k)) and x(2n - k) = conj(x(k))
+        re[2 * u] = e_re - wo_re;
+        im[2 * u] = wo_im - e_im;
+        re[2 * u + 1] = e_re + wo_re;
+        im[2 * u + 1] = -e_im - wo_im;
+      }
+    });
   }
-  // fft(product) == res
-
-  for (int i = 0; i < (base >> 1); i++) {
-    complex<float_t> a0 = (res[i] + res[i + (base >> 1)]);
-    complex<float_t> a1 = (res[i] - res[i + (base >> 1)]) *
-                          complex<float_t>(cosl(PI * i / (base >> 1)),
-                                           sinl(PI * i / (base >> 1)));
-    res[i] = a0 + a1 * complex<float_t>(0, 1);
+
+  // The real sequence from its spectrum in re() and im() in the order left
+  // by forward_real and divided by the size, left in re(). The halves of
+  // the spectrum are joined into the transform of size / 2 of the even and
+  // odd values as complex numbers, which is inverted.
+  void inverse_real() {
+    double *re = this->re(), *im = this->im();
+    size_t half = size_ >> 1;
+    RootsLevel w = roots.back();
+    // y(k) = x(k) + x(k + n) + i w^-k (x(k) - x(k + n)) at the position t of
+    // y(k) from 2t and 2t + 1, with w^(n - k) = -conj(w^k); the blocks go
+    // up, as every one of them is read from the next one
+    auto join = [re, im](size_t t, double w_re, double w_im) {
+      double d_re = re[2 * t] - re[2 * t + 1];
+      double d_im = im[2 * t] - im[2 * t + 1];
+      double s_re = re[2 * t] + re[2 * t + 1];
+      double s_im = im[2 * t] + im[2 * t + 1];
+      re[t] = s_re - (d_im * w_re - d_re * w_im);
+      im[t] = s_im + (d_re * w_re + d_im * w_im);
+    };
+    for_conjugate_pairs(half, false, [&](size_t t, size_t u, size_t k) {
+      join(t, w.re[k], w.im[k]);
+      if (u != t) join(u, -w.re[k], w.im[k]);
+    });
+    inverse(re, im, half);
+    for (size_t j = half; j-- > 0;) {
+      double even = re[j], odd = im[j];
+      re[2 * j] = even;
+      re[2 * j + 1] = odd;
+    }
   }
 
-  res.resize(base >> 1);
-  fft<float_t>(res);
-  std::vector<result_t> product(real_size);
+ private:
+  size_t size_;
+  std::vector<RootsLevel> roots;
+  std::vector<double> workspace;
+};
 
-  for (int i = 0; i < real_size; i++)
-    product[i] = ((i & 1) ? res[i >> 1].y : res[i >> 1].x) +
-                 (std::is_integral<result_t>::value) * float_t(0.5);
+const size_t PLAN_CACHE_SIZE = 4;
+// plans larger than that take too much memory to keep, such a plan is
+// dropped as soon as another size is needed
+const size_t MAX_CACHED_PLAN_SIZE = size_t(1) << 20;
 
-  return product;
+// the plan of the given size, it stays valid until the next call
+inline Plan &cached_plan(size_t size) {
+  // the most recently used plan is the last one
+  thread_local std::vector<std::unique_ptr<Plan>> plans;
+  auto found =
+      std::find_if(plans.begin(), plans.end(),
+                   [size](auto &plan) { return plan->size() == size; });
+  if (found != plans.end()) {
+    std::rotate(found, found + 1, plans.end());
+    return *plans.back();
+  }
+  if (!plans.empty() && plans.back()->size() > MAX_CACHED_PLAN_SIZE)
+    plans.pop_back();
+  if (plans.size() == PLAN_CACHE_SIZE) plans.erase(plans.begin());
+  plans.push_back(std::make_unique<Plan>(size));
+  return *plans.back();
 }
 
-template <typename T>
-std::vector<T> normalize(std::vector<T> pol) {
-  while (!pol.empty() && pol.back() == 0) pol.pop_back();
+inline double norm(const double *a, size_t size) {
+  double sum = 0;
+  for (size_t i = 0; i < size; i++) sum += a[i] * a[i];
+  // the sum of squares of integers is rounded at most size times
+  return std::sqrt(sum * (1 + UNIT_ROUNDOFF * size));
+}
+
+// exact product of polynomials with a_size and b_size non-negative integer
+// coefficients, given in plan.re() and plan.im(); the rest of the arrays
+// is cleared, the error bound is checked before the transforms, and the
+// product is left in plan.re()
+inline void convolve(Plan &plan, size_t a_size, size_t b_size) {
+  size_t size = plan.size();
+  double *re = plan.re(), *im = plan.im();
+  assert(a_size + b_size - 1 <= size);
+  assert(product_error_bound(norm(re, a_size), norm(im, b_size), size) < 0.5);
+  std::fill(re + a_size, re + size, 0.0);
+  std::fill(im + b_size, im + size, 0.0);
+  plan.forward(re, im, size);
+  // (z(k)^2 - conj(z(-k))^2) / 4i and its conjugate at -k, divided by the
+  // size for the inverse transform
+  double scale = 0.25 / double(size);
+  for_conjugate_pairs(size, false, [&](size_t t, size_t u, size_t) {
+    double d_re = (re[t] - im[t]) * (re[t] + im[t]) -
+                  (re[u] - im[u]) * (re[u] + im[u]);
+    double d_im = 2 * (re[t] * im[t] + re[u] * im[u]);
+    re[t] = d_im * scale;
+    im[t] = -d_re * scale;
+    re[u] = d_im * scale;
+    im[u] = d_re * scale;
+  });
+  plan.inverse_real();
+}
+
+// the transform of the polynomial with a_size coefficients in plan.re(),
+// left in plan.re() and plan.im(), for an operand of many products
+inline void transform(Plan &plan, size_t a_size) { plan.forward_real(a_size); }
+
+// the same as convolve with b given by its transform and its norm
+inline void convolve(Plan &plan, size_t a_size, const double *b_re,
+                     const double *b_im, double b_norm) {
+  size_t size = plan.size();
+  assert(product_error_bound(norm(plan.re(), a_size), b_norm, size) < 0.5);
+  plan.forward_real(a_size);
+  multiply_scaled(plan.re(), plan.im(), b_re, b_im, size);
+  plan.inverse_real();
+}
 
-  return pol;
+// the same with the square of the polynomial in plan.re()
+inline void square(Plan &plan, size_t a_size) {
+  size_t size = plan.size();
+  assert(2 * a_size - 1 <= size);
+  double a_norm = norm(plan.re(), a_size);
+  assert(product_error_bound(a_norm, a_norm, size) < 0.5);
+  plan.forward_real(a_size);
+  // the same operations as the product with a copy, so the same bound
+  multiply_scaled(plan.re(), plan.im(), plan.re(), plan.im(), size);
+  plan.inverse_real();
 }
 
 }  // namespace FFT
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+#include "bigint.hpp"
+
+/*
+ * Non-negative number of a width fixed at compile time, Bits bits in an
+ * array of 64-bit limbs, least significant limb first. It never allocates
+ * and never strips zeros, and its loops have constant lengths, so that the
+ * compiler unrolls them; at the sizes of a modulus that makes it several
+ * times faster than BigInteger. Addition and subtraction wrap around
+ * 2^Bits and report the carry.
+ */
+template <size_t Bits>
+class FixedBigInt {
+  static_assert(Bits > 0 && Bits % 64 == 0);
+
+ public:
+  static constexpr size_t LIMBS = Bits / 64;
+
+  constexpr FixedBigInt() : limbs{} {}
+  constexpr FixedBigInt(uint64_t value) : limbs{value} {}
+  // throws std::out_of_range for negative numbers and numbers longer
+  // than Bits bits
+  explicit FixedBigInt(const BigInteger& value) : limbs{} {
+    auto source = value.get_limbs();
+    if (value.is_negative() || source.size() > LIMBS) {
+      throw std::out_of_range("BigInteger does not fit into FixedBigInt");
+    }
+    std::copy(source.begin(), source.end(), limbs.begin());
+  }
+
+  explicit operator BigInteger() const {
+    return BigInteger::from_limbs(limbs);
+  }
+
+  constexpr uint64_t& operator[](size_t index) { return limbs[index]; }
+  constexpr const uint64_t& operator[](size_t index) const {
+    return limbs[index];
+  }
+  constexpr std::span<const uint64_t, LIMBS> get_limbs() const {
+    return limbs;
+  }
+
+  constexpr bool is_zero() const {
+    return std::all_of(limbs.begin(), limbs.end(),
+                       [](uint64_t limb) { return limb == 0; });
+  }
+
+  constexpr bool operator==(const FixedBigInt&) const = default;
+  constexpr std::strong_ordering operator<=>(const FixedBigInt& other) const {
+#pragma GCC unroll 16
+    for (size_t i = 1; i <= LIMBS; ++i) {
+      if (limbs[LIMBS - i] != other.limbs[LIMBS - i]) {
+        return limbs[LIMBS - i] <=> other.limbs[LIMBS - i];
+      }
+    }
+    return std::strong_ordering::equal;
+  }
+
+  // this += other and this -= other, return the carry and the borrow
+  constexpr uint64_t add(const FixedBigInt& other) {
+    uint64_t carry = 0;
+#pragma GCC unroll 16
+    for (size_t i = 0; i < LIMBS; ++i) {
+      double_limb_t sum = double_limb_t(limbs[i]) + other.limbs[i] + carry;
+      limbs[i] = uint64_t(sum);
+      carry = uint64_t(sum >> 64);
+    }
+    return carry;
+  }
+
+  constexpr uint64_t sub(const FixedBigInt& other) {
+    uint64_t borrow = 0;
+#pragma GCC unroll 16
+    for (size_t i = 0; i < LIMBS; ++i) {
+      double_limb_t difference =
+          double_limb_t(limbs[i]) - other.limbs[i] - borrow;
+      limbs[i] = uint64_t(difference);
+      borrow = uint64_t(difference >> 64) & 1;
+    }
+    return borrow;
+  }
+
+  constexpr FixedBigInt& operator+=(const FixedBigInt& other) {
+    add(other);
+    return *this;
+  }
+  constexpr FixedBigInt& operator-=(const FixedBigInt& other) {
+    sub(other);
+    return *this;
+  }
+  friend constexpr FixedBigInt operator+(FixedBigInt a,
+                                         const FixedBigInt& b) {
+    return a += b;
+  }
+  friend constexpr FixedBigInt operator-(FixedBigInt a,
+                                         const FixedBigInt& b) {
+    return a -= b;
+  }
+
+  // the full product, which never wraps
+  static constexpr FixedBigInt<2 * Bits> multiply(const FixedBigInt& a,
+                                                  const FixedBigInt& b) {
+    FixedBigInt<2 * Bits> res;
+#pragma GCC unroll 8
+    for (size_t i = 0; i < LIMBS; ++i) {
+      uint64_t carry = 0;
+#pragma GCC unroll 16
+      for (size_t j = 0; j < LIMBS; ++j) {
+        double_limb_t cur =
+            double_limb_t(a.limbs[j]) * b.limbs[i] + res[i + j] + carry;
+        res[i + j] = uint64_t(cur);
+        carry = uint64_t(cur >> 64);
+      }
+      res[i + LIMBS] = carry;
+    }
+    return res;
+  }
+
+  class Montgomery;
+
+ private:
+  __extension__ typedef unsigned __int128 double_limb_t;
+
+  std::array<uint64_t, LIMBS> limbs;
+};
+
+/*
+ * Odd modulus of up to Bits bits prepared for the Montgomery
+ * multiplication, which reduces by multiplications of one limb instead of
+ * a division. The residues are below the modulus; in the Montgomery form a
+ * residue x is kept as x * 2^Bits.
+ */
+template <size_t Bits>
+class FixedBigInt<Bits>::Montgomery {
+ public:
+  // throws std::logic_error for an even modulus
+  explicit constexpr Montgomery(const FixedBigInt& modulus)
+      : modulus_(modulus) {
+    if (modulus[0] % 2 == 0) {
+      throw std::logic_error("Montgomery modulus must be odd");
+    }
+    // Newton iteration doubles the correct low bits of the inverse,
+    // the modulus itself is correct in the lowest three
+    uint64_t inverse = modulus[0];
+    for (int i = 0; i < 5; ++i) {
+      inverse *= 2 - modulus[0] * inverse;
+    }
+    minus_inverse = -inverse;
+    // 2^(2 * Bits) by doublings, which is done once per modulus
+    squared_radix = modulus_ == FixedBigInt(1) ? 0 : 1;
+    for (size_t i = 0; i < 2 * Bits; ++i) {
+      uint64_t carry = squared_radix.add(squared_radix);
+      if (carry != 0 || squared_radix >= modulus_) {
+        squared_radix.sub(modulus_);
+      }
+    }
+  }
+
+  constexpr const FixedBigInt& modulus() const { return modulus_; }
+
+  // a * b / 2^Bits modulo the modulus
+  constexpr FixedBigInt multiply(const FixedBigInt& a,
+                                 const FixedBigInt& b) const {
+    // the product accumulates in LIMBS + 2 limbs and is shifted right by
+    // one limb each round
+    std::array<uint64_t, LIMBS + 2> t{};
+#pragma GCC unroll 8
+    for (size_t i = 0; i < LIMBS; ++i) {
+      uint64_t carry = 0;
+#pragma GCC unroll 16
+      for (size_t j = 0; j < LIMBS; ++j) {
+        double_limb_t cur = double_limb_t(a[j]) * b[i] + t[j] + carry;
+        t[j] = uint64_t(cur);
+        carry = uint64_t(cur >> 64);
+      }
+      double_limb_t top = double_limb_t(t[LIMBS]) + carry;
+      t[LIMBS] = uint64_t(top);
+      t[LIMBS + 1] = uint64_t(top >> 64);
+
+      uint64_t factor = t[0] * minus_inverse;
+      double_limb_t cur = double_limb_t(factor) * modulus_[0] + t[0];
+      carry = uint64_t(cur >> 64);
+#pragma GCC unroll 16
+      for (size_t j = 1; j < LIMBS; ++j) {
+        cur = double_limb_t(factor) * modulus_[j] + t[j] + carry;
+        t[j - 1] = uint64_t(cur);
+        carry = uint64_t(cur >> 64);
+      }
+      top = double_limb_t(t[LIMBS]) + carry;
+      t[LIMBS - 1] = uint64_t(top);
+      t[LIMBS] = t[LIMBS + 1] + uint64_t(top >> 64);
+    }
+    FixedBigInt res;
+    std::copy(t.begin(), t.begin() + LIMBS, res.limbs.begin());
+    if (t[LIMBS] != 0 || res >= modulus_) {
+      res.sub(modulus_);
+    }
+    return res;
+  }
+
+  constexpr FixedBigInt to_montgomery(const FixedBigInt& value) const {
+    return multiply(value, squared_radix);
+  }
+  constexpr FixedBigInt from_montgomery(const FixedBigInt& value) const {
+    return multiply(value, FixedBigInt(1));
+  }
+
+  // a * b modulo the modulus for residues in the usual form
+  constexpr FixedBigInt multiply_mod(const FixedBigInt& a,
+                                     const FixedBigInt& b) const {
+    return multiply(multiply(a, b), squared_radix);
+  }
+
+ private:
+  FixedBigInt modulus_;
+  // -modulus^(-1) modulo 2^64
+  uint64_t minus_inverse = 0;
+  // 2^(2 * Bits) modulo the modulus, turns residues into the Montgomery form
+  FixedBigInt squared_radix;
+};
@@ -0,0 +1,244 @@
+#include "kernels.hpp"
+
+#include <atomic>
+#include <stdexcept>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define KERNELS_X86 1
+#endif
+
+namespace {
+namespace Generic {
+uint64_t add_n(uint64_t* res, const uint64_t* a, const uint64_t* b,
+               size_t size) {
+  uint64_t carry = 0;
+  for (size_t i = 0; i < size; ++i) {
+    uint64_t sum = a[i] + carry;
+    carry = sum < carry;
+    res[i] = sum + b[i];
+    carry += res[i] < sum;
+  }
+  return carry;
+}
+
+uint64_t sub_n(uint64_t* res, const uint64_t* a, const uint64_t* b,
+               size_t size) {
+  uint64_t borrow = 0;
+  for (size_t i = 0; i < size; ++i) {
+    uint64_t subtrahend = b[i] + borrow;
+    borrow = subtrahend < borrow;
+    borrow += a[i] < subtrahend;
+    res[i] = a[i] - subtrahend;
+  }
+  return borrow;
+}
+
+}  // namespace Generic
+
+#ifdef KERNELS_X86
+namespace ADX {
+__attribute__((target("adx"))) uint64_t add_n(uint64_t* res,
+                                                   const uint64_t* a,
+                                                   const uint64_t* b,
+                                                   size_t size) {
+  unsigned char carry = 0;
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    unsigned long long* out = reinterpret_cast<unsigned long long*>(res + i);
+    carry = _addcarryx_u64(carry, a[i], b[i], out);
+    carry = _addcarryx_u64(carry, a[i + 1], b[i + 1], out + 1);
+    carry = _addcarryx_u64(carry, a[i + 2], b[i + 2], out + 2);
+    carry = _addcarryx_u64(carry, a[i + 3], b[i + 3], out + 3);
+  }
+  for (; i < size; ++i) {
+    carry = _addcarryx_u64(carry, a[i], b[i],
+                           reinterpret_cast<unsigned long long*>(res + i));
+  }
+  return carry;
+}
+
+__attribute__((target("adx"))) uint64_t sub_n(uint64_t* res,
+                                                   const uint64_t* a,
+                                                   const uint64_t* b,
+                                                   size_t size) {
+  unsigned char borrow = 0;
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    unsigned long long* out = reinterpret_cast<unsigned long long*>(res + i);
+    borrow = _subborrow_u64(borrow, a[i], b[i], out);
+    borrow = _subborrow_u64(borrow, a[i + 1], b[i + 1], out + 1);
+    borrow = _subborrow_u64(borrow, a[i + 2], b[i + 2], out + 2);
+    borrow = _subborrow_u64(borrow, a[i + 3], b[i + 3], out + 3);
+  }
+  for (; i < size; ++i) {
+    borrow = _subborrow_u64(borrow, a[i], b[i],
+                            reinterpret_cast<unsigned long long*>(res + i));
+  }
+  return borrow;
+}
+
+}  // namespace ADX
+
+namespace AVX2 {
+// lanes of the mask as 0 or -1
+__attribute__((target("avx2"))) inline __m256i expand_mask(unsigned mask) {
+  const __m256i bits = _mm256_set_epi64x(8, 4, 2, 1);
+  __m256i broadcast = _mm256_set1_epi64x(mask);
+  return _mm256_cmpeq_epi64(_mm256_and_si256(broadcast, bits), bits);
+}
+
+// a lane gets a carry if the previous one generated it, or if the previous
+// one is all ones and gets a carry itself, which is what adding the
+// propagate mask to the generate mask shifted by a lane does
+__attribute__((target("avx2"))) inline unsigned resolve_carries(
+    unsigned generate, unsigned propagate, unsigned& carry) {
+  unsigned incoming = ((generate << 1) | carry) + propagate;
+  carry = incoming >> 4;
+  return (incoming ^ propagate) & 0xF;
+}
+
+__attribute__((target("avx2"))) uint64_t add_n(uint64_t* res,
+                                               const uint64_t* a,
+                                               const uint64_t* b,
+                                               size_t size) {
+  const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+  const __m256i ones = _mm256_set1_epi64x(-1);
+  unsigned carry = 0;
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    __m256i sum = _mm256_add_epi64(x, y);
+    // unsigned sum < x, compared as signed with flipped top bits
+    __m256i overflow = _mm256_cmpgt_epi64(_mm256_xor_si256(x, sign),
+                                          _mm256_xor_si256(sum, sign));
+    __m256i full = _mm256_cmpeq_epi64(sum, ones);
+    unsigned generate = _mm256_movemask_pd(_mm256_castsi256_pd(overflow));
+    unsigned propagate = _mm256_movemask_pd(_mm256_castsi256_pd(full));
+    unsigned incoming = resolve_carries(generate, propagate, carry);
+    sum = _mm256_sub_epi64(sum, expand_mask(incoming));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(res + i), sum);
+  }
+  uint64_t tail_carry = carry;
+  for (; i < size; ++i) {
+    uint64_t sum = a[i] + tail_carry;
+    tail_carry = sum < tail_carry;
+    res[i] = sum + b[i];
+    tail_carry += res[i] < sum;
+  }
+  return tail_carry;
+}
+
+__attribute__((target("avx2"))) uint64_t sub_n(uint64_t* res,
+                                               const uint64_t* a,
+                                               const uint64_t* b,
+                                               size_t size) {
+  const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+  const __m256i zero = _mm256_setzero_si256();
+  unsigned borrow = 0;
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    __m256i difference = _mm256_sub_epi64(x, y);
+    // unsigned y > x
+    __m256i underflow = _mm256_cmpgt_epi64(_mm256_xor_si256(y, sign),
+                                           _mm256_xor_si256(x, sign));
+    __m256i empty = _mm256_cmpeq_epi64(difference, zero);
+    unsigned generate = _mm256_movemask_pd(_mm256_castsi256_pd(underflow));
+    unsigned propagate = _mm256_movemask_pd(_mm256_castsi256_pd(empty));
+    unsigned incoming = resolve_carries(generate, propagate, borrow);
+    difference = _mm256_add_epi64(difference, expand_mask(incoming));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(res + i), difference);
+  }
+  uint64_t tail_borrow = borrow;
+  for (; i < size; ++i) {
+    uint64_t subtrahend = b[i] + tail_borrow;
+    tail_borrow = subtrahend < tail_borrow;
+    tail_borrow += a[i] < subtrahend;
+    res[i] = a[i] - subtrahend;
+  }
+  return tail_borrow;
+}
+}  // namespace AVX2
+#endif
+
+// the carry chains were faster than the vector version on long arrays
+// and on par on short ones
+Kernels::Implementation detect() {
+  for (auto value : {Kernels::Implementation::kADX,
+                     Kernels::Implementation::kAVX2}) {
+    if (Kernels::is_supported(value)) {
+      return value;
+    }
+  }
+  return Kernels::Implementation::kGeneric;
+}
+
+// -1 until the first call, so that it works during static initialization
+std::atomic<int> implementation = -1;
+
+Kernels::Implementation current() {
+  int value = implementation.load(std::memory_order_relaxed);
+  if (value < 0) {
+    value = static_cast<int>(detect());
+    implementation.store(value, std::memory_order_relaxed);
+  }
+  return static_cast<Kernels::Implementation>(value);
+}
+}  // namespace
+
+bool Kernels::is_supported(Implementation value) {
+  switch (value) {
+    case Implementation::kGeneric:
+      return true;
+#ifdef KERNELS_X86
+    case Implementation::kADX:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("adx");
+    case Implementation::kAVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+void Kernels::set_implementation(Implementation value) {
+  if (!is_supported(value)) {
+    throw std::logic_error("Kernels implementation is not supported");
+  }
+  implementation.store(static_cast<int>(value), std::memory_order_relaxed);
+}
+
+Kernels::Implementation Kernels::get_implementation() { return current(); }
+
+uint64_t Kernels::add_n(uint64_t* res, const uint64_t* a, const uint64_t* b,
+                        size_t size) {
+  switch (current()) {
+#ifdef KERNELS_X86
+    case Implementation::kADX:
+      return ADX::add_n(res, a, b, size);
+    case Implementation::kAVX2:
+      return AVX2::add_n(res, a, b, size);
+#endif
+    default:
+      return Generic::add_n(res, a, b, size);
+  }
+}
+
+uint64_t Kernels::sub_n(uint64_t* res, const uint64_t* a, const uint64_t* b,
+                        size_t size) {
+  switch (current()) {
+#ifdef KERNELS_X86
+    case Implementation::kADX:
+      return ADX::sub_n(res, a, b, size);
+    case Implementation::kAVX2:
+      return AVX2::sub_n(res, a, b, size);
+#endif
+    default:
+      return Generic::sub_n(res, a, b, size);
+  }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Loops over arrays of 64-bit limbs, least significant limb first, that
+ * carry or borrow through them. There are several implementations, the best
+ * one the processor supports is picked at the first call.
+ */
+namespace Kernels {
+enum class Implementation {
+  kGeneric,  // portable C++
+  kADX,      // x86-64 add with carry chains
+  kAVX2      // x86-64 vector add/sub with carries resolved per 4 limbs
+};
+
+bool is_supported(Implementation);
+// throws std::logic_error if the processor does not support it
+void set_implementation(Implementation);
+Implementation get_implementation();
+
+// res = a + b, returns the carry; res may be the same array as a or b
+uint64_t add_n(uint64_t* res, const uint64_t* a, const uint64_t* b,
+               size_t size);
+// res = a - b, returns the borrow; res may be the same array as a or b
+uint64_t sub_n(uint64_t* res, const uint64_t* a, const uint64_t* b,
+               size_t size);
+// res += a * multiplier, returns the carry out of res[size - 1];
+// a mulx version with two adcx/adox chains was slower than what the
+// compiler makes of the 128-bit arithmetic, and AVX2 has no 64-bit
+// multiplication with the high half, so this one is common and inline
+inline uint64_t addmul_1(uint64_t* res, const uint64_t* a, size_t size,
+                         uint64_t multiplier) {
+  __extension__ typedef unsigned __int128 uint128_t;
+  uint64_t carry = 0;
+  for (size_t i = 0; i < size; ++i) {
+    uint128_t cur = uint128_t(a[i]) * multiplier + res[i] + carry;
+    res[i] = uint64_t(cur);
+    carry = uint64_t(cur >> 64);
+  }
+  return carry;
+}
+}  // namespace Kernels
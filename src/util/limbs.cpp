@@ -0,0 +1,154 @@
+#include "limbs.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+#include "multiply.hpp"
+
+namespace {
+__extension__ typedef unsigned __int128 double_limb_t;
+}  // namespace
+
+namespace Limbs {
+uint64_t mul_1(std::span<uint64_t> res, std::span<const uint64_t> a,
+               uint64_t multiplier) {
+  uint64_t carry = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    double_limb_t cur = double_limb_t(a[i]) * multiplier + carry;
+    res[i] = uint64_t(cur);
+    carry = uint64_t(cur >> 64);
+  }
+  return carry;
+}
+
+uint64_t submul_1(std::span<uint64_t> res, std::span<const uint64_t> a,
+                  uint64_t multiplier) {
+  uint64_t borrow = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    double_limb_t product = double_limb_t(a[i]) * multiplier + borrow;
+    uint64_t low = uint64_t(product);
+    borrow = uint64_t(product >> 64) + (res[i] < low);
+    res[i] -= low;
+  }
+  return borrow;
+}
+
+size_t mul_scratch_size(size_t a_size, size_t b_size) {
+  return Multiply::multiply_scratch_size(a_size, b_size);
+}
+
+size_t sqr_scratch_size(size_t size) {
+  return Multiply::square_scratch_size(size);
+}
+
+void mul(std::span<uint64_t> res, std::span<const uint64_t> a,
+         std::span<const uint64_t> b, std::span<uint64_t> scratch) {
+  if (a.empty() || b.empty()) {
+    std::fill(res.begin(), res.end(), 0);
+    return;
+  }
+  Multiply::multiply(a.data(), a.size(), b.data(), b.size(), res.data(),
+                     scratch.data());
+}
+
+void sqr(std::span<uint64_t> res, std::span<const uint64_t> a,
+         std::span<uint64_t> scratch) {
+  if (!a.empty()) {
+    Multiply::square(a.data(), a.size(), res.data(), scratch.data());
+  }
+}
+
+uint64_t lshift(std::span<uint64_t> res, std::span<const uint64_t> a,
+                unsigned shift) {
+  if (a.empty()) {
+    return 0;
+  }
+  if (shift == 0) {
+    std::copy(a.begin(), a.end(), res.begin());
+    return 0;
+  }
+  uint64_t overflow = a.back() >> (64 - shift);
+  for (size_t i = a.size() - 1; i > 0; --i) {
+    res[i] = (a[i] << shift) | (a[i - 1] >> (64 - shift));
+  }
+  res[0] = a[0] << shift;
+  return overflow;
+}
+
+uint64_t rshift(std::span<uint64_t> res, std::span<const uint64_t> a,
+                unsigned shift) {
+  if (a.empty()) {
+    return 0;
+  }
+  if (shift == 0) {
+    std::copy(a.begin(), a.end(), res.begin());
+    return 0;
+  }
+  uint64_t underflow = a[0] << (64 - shift);
+  for (size_t i = 0; i + 1 < a.size(); ++i) {
+    res[i] = (a[i] >> shift) | (a[i + 1] << (64 - shift));
+  }
+  res[a.size() - 1] = a.back() >> shift;
+  return underflow;
+}
+
+uint64_t divrem_1(std::span<uint64_t> quotient, std::span<const uint64_t> a,
+                  uint64_t divisor) {
+  uint64_t remainder = 0;
+  for (size_t i = a.size(); i > 0; --i) {
+    double_limb_t cur = (double_limb_t(remainder) << 64) | a[i - 1];
+    quotient[i - 1] = uint64_t(cur / divisor);
+    remainder = uint64_t(cur % divisor);
+  }
+  return remainder;
+}
+
+void divrem(std::span<uint64_t> quotient, std::span<uint64_t> remainder,
+            std::span<const uint64_t> a, std::span<const uint64_t> d,
+            std::span<uint64_t> scratch) {
+  size_t n = d.size();
+  if (n == 0 || d.back() == 0) {
+    throw std::logic_error("Division by zero");
+  }
+  if (n == 1) {
+    remainder[0] = divrem_1(quotient, a, d[0]);
+    return;
+  }
+  size_t m = a.size() - n;
+  // the top bit of the divisor is made set, so that quotient estimations
+  // are off by a small constant at most; the remainder is formed in place
+  // of the dividend, which gets an extra limb for the first step
+  unsigned shift = std::countl_zero(d.back());
+  std::span<uint64_t> v = scratch.first(n);
+  std::span<uint64_t> u = scratch.subspan(n, a.size() + 1);
+  lshift(v, d, shift);
+  u[a.size()] = lshift(u.first(a.size()), a, shift);
+  for (size_t j = m + 1; j > 0; --j) {
+    std::span<uint64_t> window = u.subspan(j - 1, n + 1);
+    // the estimation from the two top limbs is at most 2 more than the real
+    // digit, and it becomes exact except for rare cases with the third one
+    double_limb_t top = (double_limb_t(window[n]) << 64) | window[n - 1];
+    double_limb_t qhat = top / v[n - 1];
+    double_limb_t rhat = top % v[n - 1];
+    while ((qhat >> 64) != 0 ||
+           qhat * v[n - 2] > ((rhat << 64) | window[n - 2])) {
+      --qhat;
+      rhat += v[n - 1];
+      if ((rhat >> 64) != 0) {
+        break;
+      }
+    }
+    uint64_t borrow = submul_1(window.first(n), v, uint64_t(qhat));
+    bool negative = window[n] < borrow;
+    window[n] -= borrow;
+    if (negative) {
+      // qhat was still one more, add the divisor back
+      --qhat;
+      window[n] += add_n(window.first(n), window.first(n), v);
+    }
+    quotient[j - 1] = uint64_t(qhat);
+  }
+  rshift(remainder, u.first(n), shift);
+}
+}  // namespace Limbs
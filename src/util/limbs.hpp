@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "kernels.hpp"
+
+/*
+ * Natural numbers as spans of 64-bit limbs, least significant limb first,
+ * in the manner of the mpn layer of GMP. The functions write into buffers
+ * of the caller, leading zero limbs are allowed everywhere. The ones that
+ * need temporary space take it as a scratch span of the caller, of the
+ * size that their _scratch_size function returns, and keep nothing between
+ * the calls; only the transforms of the largest products and the products
+ * run in parallel allocate memory of their own. BigInteger and
+ * ModuledBigInt are built on them.
+ *
+ * The short loops are inline, as the callers mostly run them on a few limbs.
+ * The buffer sizes are preconditions and are not checked. Results may be
+ * the same span as an operand where it is said so, and must not overlap
+ * the operands otherwise.
+ */
+namespace Limbs {
+// the size of a without its leading zero limbs
+inline size_t trimmed_size(std::span<const uint64_t> a) {
+  size_t size = a.size();
+  while (size > 0 && a[size - 1] == 0) {
+    --size;
+  }
+  return size;
+}
+
+// numbers of the same size
+inline std::strong_ordering compare_n(std::span<const uint64_t> a,
+                                      std::span<const uint64_t> b) {
+  for (size_t i = a.size(); i > 0; --i) {
+    if (a[i - 1] != b[i - 1]) {
+      return a[i - 1] <=> b[i - 1];
+    }
+  }
+  return std::strong_ordering::equal;
+}
+
+// numbers of any sizes
+inline std::strong_ordering compare(std::span<const uint64_t> a,
+                                    std::span<const uint64_t> b) {
+  size_t a_size = trimmed_size(a);
+  size_t b_size = trimmed_size(b);
+  if (a_size != b_size) {
+    return a_size <=> b_size;
+  }
+  return compare_n(a.first(a_size), b.first(b_size));
+}
+
+// res = a + b and res = a - b for operands of the same size, return the
+// carry and the borrow; res may be a or b
+inline uint64_t add_n(std::span<uint64_t> res, std::span<const uint64_t> a,
+                      std::span<const uint64_t> b) {
+  return Kernels::add_n(res.data(), a.data(), b.data(), a.size());
+}
+
+inline uint64_t sub_n(std::span<uint64_t> res, std::span<const uint64_t> a,
+                      std::span<const uint64_t> b) {
+  return Kernels::sub_n(res.data(), a.data(), b.data(), a.size());
+}
+
+// res = a + value and res = a - value for res of the size of a; res may be a
+inline uint64_t add_1(std::span<uint64_t> res, std::span<const uint64_t> a,
+                      uint64_t value) {
+  size_t i = 0;
+  for (; value != 0 && i < a.size(); ++i) {
+    res[i] = a[i] + value;
+    value = res[i] < value;
+  }
+  if (res.data() != a.data()) {
+    std::copy(a.begin() + i, a.end(), res.begin() + i);
+  }
+  return value;
+}
+
+inline uint64_t sub_1(std::span<uint64_t> res, std::span<const uint64_t> a,
+                      uint64_t value) {
+  size_t i = 0;
+  for (; value != 0 && i < a.size(); ++i) {
+    uint64_t limb = a[i];
+    res[i] = limb - value;
+    value = limb < value;
+  }
+  if (res.data() != a.data()) {
+    std::copy(a.begin() + i, a.end(), res.begin() + i);
+  }
+  return value;
+}
+
+// the same with b not longer than a and res of the size of a
+inline uint64_t add(std::span<uint64_t> res, std::span<const uint64_t> a,
+                    std::span<const uint64_t> b) {
+  uint64_t carry = add_n(res, a.first(b.size()), b);
+  return add_1(res.subspan(b.size()), a.subspan(b.size()), carry);
+}
+
+inline uint64_t sub(std::span<uint64_t> res, std::span<const uint64_t> a,
+                    std::span<const uint64_t> b) {
+  uint64_t borrow = sub_n(res, a.first(b.size()), b);
+  return sub_1(res.subspan(b.size()), a.subspan(b.size()), borrow);
+}
+
+// res = a * multiplier, returns the limb above res; res may be a
+uint64_t mul_1(std::span<uint64_t> res, std::span<const uint64_t> a,
+               uint64_t multiplier);
+// res += a * multiplier and res -= a * multiplier for res of the size of a,
+// return the limb carried or borrowed out of it
+inline uint64_t addmul_1(std::span<uint64_t> res, std::span<const uint64_t> a,
+                         uint64_t multiplier) {
+  return Kernels::addmul_1(res.data(), a.data(), a.size(), multiplier);
+}
+
+uint64_t submul_1(std::span<uint64_t> res, std::span<const uint64_t> a,
+                  uint64_t multiplier);
+// the scratch space of mul and sqr in limbs, 0 for the schoolbook sizes;
+// it depends on Thresholds::current()
+size_t mul_scratch_size(size_t a_size, size_t b_size);
+size_t sqr_scratch_size(size_t size);
+// res = a * b, res has a.size() + b.size() limbs and scratch at least
+// mul_scratch_size(a.size(), b.size()) limbs
+void mul(std::span<uint64_t> res, std::span<const uint64_t> a,
+         std::span<const uint64_t> b, std::span<uint64_t> scratch);
+// res = a * a, res has 2 * a.size() limbs and scratch at least
+// sqr_scratch_size(a.size()) limbs
+void sqr(std::span<uint64_t> res, std::span<const uint64_t> a,
+         std::span<uint64_t> scratch);
+
+// res = a << shift and res = a >> shift for shift below 64, res has the
+// size of a; return the bits shifted out, at the bottom of the limb for
+// lshift and at the top for rshift; res may be a
+uint64_t lshift(std::span<uint64_t> res, std::span<const uint64_t> a,
+                unsigned shift);
+uint64_t rshift(std::span<uint64_t> res, std::span<const uint64_t> a,
+                unsigned shift);
+
+// quotient = a / divisor, returns the remainder; quotient has the size of
+// a and may be a
+uint64_t divrem_1(std::span<uint64_t> quotient, std::span<const uint64_t> a,
+                  uint64_t divisor);
+// quotient = a / d and remainder = a % d by the long division, Knuth's
+// algorithm D, for a at least as long as d and d with a nonzero top limb.
+// quotient has a.size() - d.size() + 1 limbs and remainder d.size() limbs,
+// remainder may be the low limbs of a. The normalized operands go to
+// scratch, which has divrem_scratch_size(a.size(), d.size()) limbs.
+// Throws std::logic_error for a zero top limb of d.
+void divrem(std::span<uint64_t> quotient, std::span<uint64_t> remainder,
+            std::span<const uint64_t> a, std::span<const uint64_t> d,
+            std::span<uint64_t> scratch);
+// a_size + d_size + 1
+inline size_t divrem_scratch_size(size_t a_size, size_t d_size) {
+  return a_size + d_size + 1;
+}
+}  // namespace Limbs
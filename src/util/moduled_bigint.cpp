@@ -1,24 +1,114 @@
 #include "moduled_bigint.hpp"
 
-ModuledBigInt::ModuledBigInt() {}
+#include <optional>
 
-ModuledBigInt::ModuledBigInt(const BigInteger& val) : value(val) {
+#include "limbs.hpp"
+
+namespace {
+// the modulus prepared for repeated reductions, it is rebuilt when N is
+// reassigned; it outlives any scoped memory resource, so it is built on
+// the heap
+const BigInteger::Reciprocal& modulus_reciprocal() {
+  thread_local BigInteger::Reciprocal reciprocal = [] {
+    BigInteger::MemoryScope heap(nullptr);
+    return BigInteger::Reciprocal(ModuledBigInt::N);
+  }();
+  if (reciprocal.divisor() != ModuledBigInt::N) {
+    BigInteger::MemoryScope heap(nullptr);
+    reciprocal = BigInteger::Reciprocal(ModuledBigInt::N);
+  }
+  return reciprocal;
+}
+
+// N in the Montgomery form of Bits bits, or nothing if N does not fit it
+template <size_t Bits>
+const typename FixedBigInt<Bits>::Montgomery* fixed_modulus() {
+  thread_local BigInteger modulus = [] {
+    BigInteger::MemoryScope heap(nullptr);
+    return BigInteger(-1);
+  }();
+  thread_local std::optional<typename FixedBigInt<Bits>::Montgomery> prepared;
+  if (modulus != ModuledBigInt::N) {
+    BigInteger::MemoryScope heap(nullptr);
+    modulus = ModuledBigInt::N;
+    prepared.reset();
+    auto limbs = modulus.get_limbs();
+    if (modulus.is_positive() && limbs.size() <= FixedBigInt<Bits>::LIMBS &&
+        limbs[0] % 2 == 1) {
+      prepared.emplace(FixedBigInt<Bits>(modulus));
+    }
+  }
+  return prepared ? &*prepared : nullptr;
+}
+
+template <size_t Bits>
+bool fixed_product(const BigInteger& a, const BigInteger& b,
+                   BigInteger& res) {
+  auto modulus = fixed_modulus<Bits>();
+  if (modulus == nullptr || a.is_negative() || b.is_negative() ||
+      a.get_limbs().size() > FixedBigInt<Bits>::LIMBS ||
+      b.get_limbs().size() > FixedBigInt<Bits>::LIMBS) {
+    return false;
+  }
+  FixedBigInt<Bits> x(a);
+  FixedBigInt<Bits> y(b);
+  if (x >= modulus->modulus() || y >= modulus->modulus()) {
+    return false;
+  }
+  res = BigInteger(modulus->multiply_mod(x, y));
+  return true;
+}
+
+// a value that takes no more limbs than N, as residues do; the sums and
+// differences of those are reduced on the limbs of N
+bool fits_modulus(const BigInteger& value) {
+  return !value.is_negative() && ModuledBigInt::N.is_positive() &&
+         value.get_limbs().size() <= ModuledBigInt::N.get_limbs().size();
+}
+
+// res = a * b modulo N by the Montgomery multiplication of the smallest
+// fixed width that holds an odd N; false if it does not apply and res is
+// intact. It takes two Montgomery products, which beat the product and the
+// division twice for 256-bit moduli and by a third for 512-bit ones, and
+// lose to them from 1024 bits on. An N of a width known at compile time is
+// better served by BasicModuledBigInt<FixedBigInt<Bits>>, which keeps the
+// Montgomery form between the operations.
+bool fixed_product(const BigInteger& a, const BigInteger& b,
+                   BigInteger& res) {
+  size_t size = ModuledBigInt::N.get_limbs().size();
+  if (size <= 4) {
+    return fixed_product<256>(a, b, res);
+  }
+  if (size <= 8) {
+    return fixed_product<512>(a, b, res);
+  }
+  return false;
+}
+}  // namespace
+
+ModuledBigInt::BasicModuledBigInt() {}
+
+ModuledBigInt::BasicModuledBigInt(const BigInteger& val) : value(val) {
   fix_value();
 }
 
-ModuledBigInt::ModuledBigInt(long long val) : value(val) { fix_value(); }
+ModuledBigInt::BasicModuledBigInt(const ModuledBigInt& other,
+                                  std::pmr::memory_resource* resource)
+    : value(other.value, resource) {}
+
+ModuledBigInt::BasicModuledBigInt(long long val) : value(val) { fix_value(); }
 
 void ModuledBigInt::fix_value() {
   if (!value.is_negative() && value < N) {
     return;
   }
-  value %= N;
+  value = BigInteger::divide(std::move(value), modulus_reciprocal()).second;
   if (value.is_negative()) {
     value += N;
   }
 }
 
-ModuledBigInt::ModuledBigInt(BigInteger&& val) : value(std::move(val)) {
+ModuledBigInt::BasicModuledBigInt(BigInteger&& val) : value(std::move(val)) {
   fix_value();
 }
 
@@ -28,6 +118,18 @@ std::strong_ordering ModuledBigInt::operator<=>(
 }
 
 ModuledBigInt& ModuledBigInt::operator+=(const ModuledBigInt& other) {
+  if (fits_modulus(value) && fits_modulus(other.value)) {
+    // the sum of residues is below 2N, so N is subtracted at most once
+    auto modulus = N.get_limbs();
+    value.limbs.resize(modulus.size());
+    uint64_t carry = Limbs::add(value.mutable_limbs(), value.get_limbs(),
+                                other.value.get_limbs());
+    if (carry != 0 || Limbs::compare_n(value.get_limbs(), modulus) >= 0) {
+      Limbs::sub_n(value.mutable_limbs(), value.get_limbs(), modulus);
+    }
+    value.fix_zero_digits();
+    return *this;
+  }
   value += other.value;
   if (value >= N) {
     value -= N;
@@ -36,6 +138,18 @@ ModuledBigInt& ModuledBigInt::operator+=(const ModuledBigInt& other) {
 }
 
 ModuledBigInt& ModuledBigInt::operator-=(const ModuledBigInt& other) {
+  if (fits_modulus(value) && fits_modulus(other.value)) {
+    // a borrow out of the top means the difference is negative, and N
+    // added to it wraps it back
+    auto modulus = N.get_limbs();
+    value.limbs.resize(modulus.size());
+    if (Limbs::sub(value.mutable_limbs(), value.get_limbs(),
+                   other.value.get_limbs()) != 0) {
+      Limbs::add_n(value.mutable_limbs(), value.get_limbs(), modulus);
+    }
+    value.fix_zero_digits();
+    return *this;
+  }
   value -= other.value;
   if (value.is_negative()) {
     value += N;
@@ -44,8 +158,68 @@ ModuledBigInt& ModuledBigInt::operator-=(const ModuledBigInt& other) {
 }
 
 ModuledBigInt& ModuledBigInt::operator*=(const ModuledBigInt& other) {
+  if (fixed_product(value, other.value, value)) {
+    return *this;
+  }
   value *= other.value;
-  value %= N;
+  fix_value();
+  return *this;
+}
+
+ModuledBigInt& ModuledBigInt::operator*=(const Prepared& other) {
+  if (fixed_product(value, other.get_value(), value)) {
+    return *this;
+  }
+  value *= other.value;
+  fix_value();
+  return *this;
+}
+
+ModuledBigInt operator*(const ModuledBigInt& a,
+                        const ModuledBigInt::Prepared& b) {
+  ModuledBigInt ans;
+  if (fixed_product(a.value, b.get_value(), ans.value)) {
+    return ans;
+  }
+  return ModuledBigInt(a.value * b.value);
+}
+
+ModuledBigInt::Prepared::Prepared(const ModuledBigInt& value)
+    : value(value.value) {}
+
+const BigInteger& ModuledBigInt::Prepared::get_value() const {
+  return value.value();
+}
+
+ModuledBigInt ModuledBigInt::square() const {
+  ModuledBigInt ans;
+  if (fixed_product(value, value, ans.value)) {
+    return ans;
+  }
+  return ModuledBigInt(value.square());
+}
+
+ModuledBigInt& ModuledBigInt::addmul(const ModuledBigInt& a,
+                                     const ModuledBigInt& b) {
+  BigInteger product;
+  if (fixed_product(a.value, b.value, product)) {
+    value += product;
+  } else {
+    value.addmul(a.value, b.value);
+  }
+  fix_value();
+  return *this;
+}
+
+ModuledBigInt& ModuledBigInt::submul(const ModuledBigInt& a,
+                                     const ModuledBigInt& b) {
+  BigInteger product;
+  if (fixed_product(a.value, b.value, product)) {
+    value -= product;
+  } else {
+    value.submul(a.value, b.value);
+  }
+  fix_value();
   return *this;
 }
 
@@ -62,9 +236,11 @@ ModuledBigInt operator-(const ModuledBigInt& a, const ModuledBigInt& b) {
 }
 
 ModuledBigInt operator*(const ModuledBigInt& a, const ModuledBigInt& b) {
-  ModuledBigInt ans(a);
-  ans *= b;
-  return ans;
+  ModuledBigInt ans;
+  if (fixed_product(a.value, b.value, ans.value)) {
+    return ans;
+  }
+  return ModuledBigInt(a.value * b.value);
 }
 
 ModuledBigInt operator-(const ModuledBigInt& a) {
@@ -73,34 +249,196 @@ ModuledBigInt operator-(const ModuledBigInt& a) {
   return ans;
 }
 
+ModuledBigInt operator+(ModuledBigInt&& a, const ModuledBigInt& b) {
+  a += b;
+  return std::move(a);
+}
+
+ModuledBigInt operator+(const ModuledBigInt& a, ModuledBigInt&& b) {
+  b += a;
+  return std::move(b);
+}
+
+ModuledBigInt operator+(ModuledBigInt&& a, ModuledBigInt&& b) {
+  a += b;
+  return std::move(a);
+}
+
+ModuledBigInt operator-(ModuledBigInt&& a, const ModuledBigInt& b) {
+  a -= b;
+  return std::move(a);
+}
+
+ModuledBigInt operator-(const ModuledBigInt& a, ModuledBigInt&& b) {
+  b -= a;
+  return -std::move(b);
+}
+
+ModuledBigInt operator-(ModuledBigInt&& a, ModuledBigInt&& b) {
+  a -= b;
+  return std::move(a);
+}
+
+ModuledBigInt operator*(ModuledBigInt&& a, const ModuledBigInt& b) {
+  a *= b;
+  return std::move(a);
+}
+
+ModuledBigInt operator*(const ModuledBigInt& a, ModuledBigInt&& b) {
+  b *= a;
+  return std::move(b);
+}
+
+ModuledBigInt operator*(ModuledBigInt&& a, ModuledBigInt&& b) {
+  a *= b;
+  return std::move(a);
+}
+
+ModuledBigInt operator-(ModuledBigInt&& a) {
+  if (!a.value.is_zero()) {
+    a.value = ModuledBigInt::N - std::move(a.value);
+  }
+  return std::move(a);
+}
+
 std::ostream& operator<<(std::ostream& os, const ModuledBigInt& a) {
   os << a.value;
   return os;
 }
 
+ModuledBigInt ModuledBigInt::inversed() const {
+  auto [gcd, x] = BigInteger::gcd_extended(value, N);
+  if (gcd != 1) {
+    return ModuledBigInt();
+  }
+  return ModuledBigInt(std::move(x));
+}
+
 namespace {
-// returns {x, y} such that ax+by=1 if a and b are coprime
-// returns {0, 0} otherwise
-std::pair<BigInteger, BigInteger> gcd_extended(BigInteger a, BigInteger b) {
-  if (b.is_zero()) {
-    if (a == BigInteger(1)) {
-      return make_pair(BigInteger(1), BigInteger(0));
+ModuledBigInt multiply_residues(const ModuledBigInt& a,
+                                const ModuledBigInt& b) {
+  return a * b;
+}
+
+ModuledBigInt square_residue(const ModuledBigInt& a) { return a.square(); }
+
+// the base of a power with the exponent, inverted for a negative exponent
+ModuledBigInt signed_base(const ModuledBigInt& base,
+                          const BigInteger& exponent) {
+  if (!exponent.is_negative()) {
+    return base;
+  }
+  ModuledBigInt inverse = base.inversed();
+  if (inverse == ModuledBigInt()) {
+    throw std::domain_error("ModuledBigInt has no inverse");
+  }
+  return inverse;
+}
+}  // namespace
+
+ModuledBigInt pow(const ModuledBigInt& base, const BigInteger& exponent) {
+  return Exponent::sliding_window(signed_base(base, exponent),
+                                  exponent.get_limbs(), ModuledBigInt(1),
+                                  multiply_residues, square_residue);
+}
+
+ModuledBigInt ModuledBigInt::multi_pow(std::span<const ModuledBigInt> bases,
+                                       std::span<const BigInteger> exponents) {
+  if (bases.size() != exponents.size()) {
+    throw std::invalid_argument("multi_pow takes an exponent for every base");
+  }
+  std::vector<ModuledBigInt> signed_bases;
+  std::vector<std::span<const uint64_t>> magnitudes;
+  for (size_t i = 0; i < bases.size(); ++i) {
+    signed_bases.push_back(signed_base(bases[i], exponents[i]));
+    magnitudes.push_back(exponents[i].get_limbs());
+  }
+  return Exponent::interleaved<ModuledBigInt>(
+      signed_bases, magnitudes, ModuledBigInt(1), multiply_residues,
+      square_residue);
+}
+
+ModuledBigInt::FixedBase::FixedBase(const ModuledBigInt& base,
+                                    size_t max_bits, unsigned teeth)
+    : base_(base), teeth(teeth) {
+  if (teeth == 0 || teeth > 16) {
+    throw std::invalid_argument("FixedBase takes from 1 to 16 teeth");
+  }
+  spacing = (max_bits + teeth - 1) / teeth;
+  table.assign(size_t(1) << teeth, ModuledBigInt(1));
+  // base^(2^(row * spacing)) goes to the entry of the single row, the
+  // other entries are products of the entries of their rows
+  ModuledBigInt row_power = base;
+  for (unsigned row = 0; row < teeth; ++row) {
+    size_t row_bit = size_t(1) << row;
+    table[row_bit] = row_power;
+    for (size_t subset = 1; subset < row_bit; ++subset) {
+      table[row_bit | subset] = table[subset] * row_power;
+    }
+    for (size_t i = 0; i < spacing && row + 1 < teeth; ++i) {
+      row_power = row_power.square();
     }
-    // not coprime
-    return make_pair(BigInteger(), BigInteger());
   }
-  auto [quot, rem] = BigInteger::divide(a, b);
-  auto [x1, y1] = gcd_extended(b, rem);
-  return make_pair(y1, x1 - y1 * quot);
 }
-};  // namespace
 
-ModuledBigInt ModuledBigInt::inversed() const {
+const ModuledBigInt& ModuledBigInt::FixedBase::base() const { return base_; }
 
-  return gcd_extended(value, ModuledBigInt::N).first;
+ModuledBigInt ModuledBigInt::FixedBase::pow(const BigInteger& exponent) const {
+  auto limbs = exponent.get_limbs();
+  if (exponent.is_negative() ||
+      Exponent::bit_length(limbs) > size_t(teeth) * spacing) {
+    return ::pow(base_, exponent);
+  }
+  ModuledBigInt result(1);
+  bool started = false;
+  for (size_t column = spacing; column > 0; --column) {
+    if (started) {
+      result = result.square();
+    }
+    size_t subset = 0;
+    for (unsigned row = 0; row < teeth; ++row) {
+      subset |= size_t(Exponent::bit(limbs, row * spacing + column - 1))
+                << row;
+    }
+    if (subset != 0) {
+      result = started ? result * table[subset] : table[subset];
+      started = true;
+    }
+  }
+  return result;
 }
 
 const BigInteger& ModuledBigInt::get_value() const { return value; }
 
-BigInteger ModuledBigInt::N = BigInteger(
-    "27606985387162255149739023449107931668458716142620601169954803000803329");
+std::pmr::memory_resource* ModuledBigInt::get_memory_resource() const {
+  return value.get_memory_resource();
+}
+
+// constant initialization, so N is ready before any dynamic initializer
+constinit BigInteger ModuledBigInt::N = DEFAULT_N;
+
+size_t ModuledBigInt::byte_size() { return N.byte_length(); }
+
+std::vector<uint8_t> ModuledBigInt::to_bytes(ByteOrder order) const {
+  return value.to_bytes(byte_size(), order);
+}
+
+void ModuledBigInt::to_bytes(std::span<uint8_t> out, ByteOrder order) const {
+  if (out.size() != byte_size()) {
+    throw std::length_error("ModuledBigInt takes exactly byte_size() bytes");
+  }
+  value.to_bytes(out, order);
+}
+
+ModuledBigInt ModuledBigInt::from_bytes(std::span<const uint8_t> in,
+                                        ByteOrder order) {
+  if (in.size() != byte_size()) {
+    throw std::length_error("ModuledBigInt takes exactly byte_size() bytes");
+  }
+  ModuledBigInt ans;
+  ans.value = BigInteger::from_bytes(in, order);
+  if (ans.value >= N) {
+    throw std::out_of_range("ModuledBigInt is not below N");
+  }
+  return ans;
+}
@@ -1,19 +1,42 @@
 #pragma once
 
 #include <compare>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <vector>
 
 #include "bigint.hpp"
+#include "exponent.hpp"
+#include "fixed_bigint.hpp"
 
-class ModuledBigInt {
+/*
+ * Residues modulo N kept in numbers of the type Value. ModuledBigInt keeps
+ * them in BigInteger for an N that is assigned at run time;
+ * BasicModuledBigInt<FixedBigInt<Bits>> below keeps them in the fixed
+ * width of an N known to fit it.
+ */
+template <typename Value>
+class BasicModuledBigInt;
+
+using ModuledBigInt = BasicModuledBigInt<BigInteger>;
+
+template <>
+class BasicModuledBigInt<BigInteger> {
  public:
+  // the modulus of the protocol, built at compile time
+  static constexpr BigInteger DEFAULT_N =
+      27606985387162255149739023449107931668458716142620601169954803000803329_bi;
   static BigInteger N;
 
-  ModuledBigInt();
-  ModuledBigInt(long long);
-  ModuledBigInt(const BigInteger&);
-  ModuledBigInt(BigInteger&&);
-  ModuledBigInt(const ModuledBigInt&) = default;
-  ModuledBigInt(ModuledBigInt&&) = default;
+  BasicModuledBigInt();
+  BasicModuledBigInt(long long);
+  BasicModuledBigInt(const BigInteger&);
+  BasicModuledBigInt(BigInteger&&);
+  BasicModuledBigInt(const ModuledBigInt&) = default;
+  BasicModuledBigInt(ModuledBigInt&&) = default;
+  // a copy with the limbs in the given resource, see BigInteger
+  BasicModuledBigInt(const ModuledBigInt&, std::pmr::memory_resource*);
 
   ModuledBigInt& operator=(const ModuledBigInt&) = default;
   ModuledBigInt& operator=(ModuledBigInt&&) = default;
@@ -31,16 +54,278 @@ class ModuledBigInt {
   friend ModuledBigInt operator*(const ModuledBigInt&, const ModuledBigInt&);
   friend ModuledBigInt operator-(const ModuledBigInt&);
 
+  // the result takes the buffer of an rvalue operand
+  friend ModuledBigInt operator+(ModuledBigInt&&, const ModuledBigInt&);
+  friend ModuledBigInt operator+(const ModuledBigInt&, ModuledBigInt&&);
+  friend ModuledBigInt operator+(ModuledBigInt&&, ModuledBigInt&&);
+  friend ModuledBigInt operator-(ModuledBigInt&&, const ModuledBigInt&);
+  friend ModuledBigInt operator-(const ModuledBigInt&, ModuledBigInt&&);
+  friend ModuledBigInt operator-(ModuledBigInt&&, ModuledBigInt&&);
+  friend ModuledBigInt operator*(ModuledBigInt&&, const ModuledBigInt&);
+  friend ModuledBigInt operator*(const ModuledBigInt&, ModuledBigInt&&);
+  friend ModuledBigInt operator*(ModuledBigInt&&, ModuledBigInt&&);
+  friend ModuledBigInt operator-(ModuledBigInt&&);
+
+  // a value that is multiplied by many times, see BigInteger::Prepared
+  class Prepared;
+
+  ModuledBigInt& operator*=(const Prepared&);
+  friend ModuledBigInt operator*(const ModuledBigInt&, const Prepared&);
+
+  ModuledBigInt square() const;
+
+  // this += a * b and this -= a * b with a single reduction
+  ModuledBigInt& addmul(const ModuledBigInt& a, const ModuledBigInt& b);
+  ModuledBigInt& submul(const ModuledBigInt& a, const ModuledBigInt& b);
+
   // returns 0 if there is no inverse
   // when value and N are coprime
   ModuledBigInt inversed() const;
 
+  // base^exponent by sliding windows; a negative exponent takes the
+  // inverse of base and throws std::domain_error if there is none
+  friend ModuledBigInt pow(const ModuledBigInt& base,
+                           const BigInteger& exponent);
+  // the product of bases[i]^exponents[i], which shares the squarings and
+  // costs little more than a single power; throws std::invalid_argument
+  // if the spans differ in size
+  static ModuledBigInt multi_pow(std::span<const ModuledBigInt> bases,
+                                 std::span<const BigInteger> exponents);
+  // a base raised to many exponents, like a generator
+  class FixedBase;
+
+  using ByteOrder = BigInteger::ByteOrder;
+
+  // every value is encoded in the byte length of N
+  static size_t byte_size();
+  std::vector<uint8_t> to_bytes(ByteOrder = ByteOrder::kBigEndian) const;
+  // out must have exactly byte_size() bytes
+  void to_bytes(std::span<uint8_t> out,
+                ByteOrder = ByteOrder::kBigEndian) const;
+  // throws std::length_error if the size is not byte_size() and
+  // std::out_of_range if the value is not below N
+  static ModuledBigInt from_bytes(std::span<const uint8_t>,
+                                  ByteOrder = ByteOrder::kBigEndian);
+
   friend std::ostream& operator<<(std::ostream&, const ModuledBigInt&);
 
   const BigInteger& get_value() const;
+  std::pmr::memory_resource* get_memory_resource() const;
 
  private:
   void fix_value();
 
   BigInteger value;
 };
+
+ModuledBigInt pow(const ModuledBigInt& base, const BigInteger& exponent);
+
+class ModuledBigInt::Prepared {
+ public:
+  explicit Prepared(const ModuledBigInt&);
+
+  const BigInteger& get_value() const;
+
+ private:
+  friend ModuledBigInt;
+  friend ModuledBigInt operator*(const ModuledBigInt&, const Prepared&);
+
+  BigInteger::Prepared value;
+};
+
+/*
+ * Fixed-base exponentiation by the comb method of Lim and Lee. An exponent
+ * of up to max_bits bits is cut into teeth rows of spacing bits each, and
+ * the products of base^(2^(row * spacing)) over every subset of rows are
+ * kept in a table of 2^teeth values; a power then costs spacing squarings
+ * and as many products, against max_bits squarings for pow(). Longer
+ * exponents go through pow().
+ */
+class ModuledBigInt::FixedBase {
+ public:
+  FixedBase(const ModuledBigInt& base, size_t max_bits, unsigned teeth = 6);
+
+  const ModuledBigInt& base() const;
+  // the same as pow(base(), exponent)
+  ModuledBigInt pow(const BigInteger& exponent) const;
+
+ private:
+  ModuledBigInt base_;
+  unsigned teeth;
+  size_t spacing;
+  std::vector<ModuledBigInt> table;
+};
+
+/*
+ * Residues modulo an N of up to Bits bits, with the width known at compile
+ * time. The value stays in the Montgomery form of FixedBigInt<Bits> between
+ * the operations, so that a product is one Montgomery multiplication and
+ * nothing allocates; the conversions are left to the constructors and
+ * get_value(). N starts as ModuledBigInt::DEFAULT_N and is assigned as a
+ * Modulus, which must be odd; values made under another N are invalid.
+ */
+template <size_t Bits>
+class BasicModuledBigInt<FixedBigInt<Bits>> {
+  static_assert(Bits >= 256, "the default N takes 256 bits");
+
+ public:
+  using Value = FixedBigInt<Bits>;
+  using Modulus = typename Value::Montgomery;
+
+  static constinit inline Modulus N = Modulus([] {
+    Value n;
+    auto limbs = ModuledBigInt::DEFAULT_N.get_limbs();
+    for (size_t i = 0; i < limbs.size(); ++i) {
+      n[i] = limbs[i];
+    }
+    return n;
+  }());
+
+  constexpr BasicModuledBigInt() = default;
+  BasicModuledBigInt(long long value)
+      : montgomery(N.to_montgomery(
+            value < 0 ? -uint64_t(value) : uint64_t(value))) {
+    if (value < 0) {
+      montgomery = negated(montgomery);
+    }
+  }
+  BasicModuledBigInt(const BigInteger& value) {
+    auto limbs = value.get_limbs();
+    if (!value.is_negative() && limbs.size() <= Value::LIMBS) {
+      montgomery = N.to_montgomery(Value(value));
+      return;
+    }
+    BigInteger modulus(N.modulus());
+    BigInteger residue = value % modulus;
+    if (residue.is_negative()) {
+      residue += modulus;
+    }
+    montgomery = N.to_montgomery(Value(residue));
+  }
+  // any value below 2^Bits, it is reduced
+  explicit BasicModuledBigInt(const Value& value)
+      : montgomery(N.to_montgomery(value)) {}
+
+  constexpr bool operator==(const BasicModuledBigInt&) const = default;
+  std::strong_ordering operator<=>(const BasicModuledBigInt& other) const {
+    return get_value() <=> other.get_value();
+  }
+
+  BasicModuledBigInt& operator+=(const BasicModuledBigInt& other) {
+    uint64_t carry = montgomery.add(other.montgomery);
+    if (carry != 0 || montgomery >= N.modulus()) {
+      montgomery.sub(N.modulus());
+    }
+    return *this;
+  }
+  BasicModuledBigInt& operator-=(const BasicModuledBigInt& other) {
+    if (montgomery.sub(other.montgomery) != 0) {
+      montgomery.add(N.modulus());
+    }
+    return *this;
+  }
+  BasicModuledBigInt& operator*=(const BasicModuledBigInt& other) {
+    montgomery = N.multiply(montgomery, other.montgomery);
+    return *this;
+  }
+
+  friend BasicModuledBigInt operator+(BasicModuledBigInt a,
+                                      const BasicModuledBigInt& b) {
+    return a += b;
+  }
+  friend BasicModuledBigInt operator-(BasicModuledBigInt a,
+                                      const BasicModuledBigInt& b) {
+    return a -= b;
+  }
+  friend BasicModuledBigInt operator*(BasicModuledBigInt a,
+                                      const BasicModuledBigInt& b) {
+    return a *= b;
+  }
+  friend BasicModuledBigInt operator-(BasicModuledBigInt a) {
+    a.montgomery = negated(a.montgomery);
+    return a;
+  }
+
+  // there is nothing to prepare in a product of one Montgomery
+  // multiplication
+  using Prepared = BasicModuledBigInt;
+
+  BasicModuledBigInt square() const { return *this * *this; }
+
+  BasicModuledBigInt& addmul(const BasicModuledBigInt& a,
+                             const BasicModuledBigInt& b) {
+    return *this += a * b;
+  }
+  BasicModuledBigInt& submul(const BasicModuledBigInt& a,
+                             const BasicModuledBigInt& b) {
+    return *this -= a * b;
+  }
+
+  // returns 0 if there is no inverse
+  BasicModuledBigInt inversed() const {
+    auto [gcd, x] = BigInteger::gcd_extended(BigInteger(get_value()),
+                                             BigInteger(N.modulus()));
+    if (gcd != 1) {
+      return BasicModuledBigInt();
+    }
+    return BasicModuledBigInt(x);
+  }
+
+  // the same as for ModuledBigInt
+  friend BasicModuledBigInt pow(const BasicModuledBigInt& base,
+                                const BigInteger& exponent) {
+    return Exponent::sliding_window(signed_base(base, exponent),
+                                    exponent.get_limbs(),
+                                    BasicModuledBigInt(1), multiply, square_of);
+  }
+  static BasicModuledBigInt multi_pow(
+      std::span<const BasicModuledBigInt> bases,
+      std::span<const BigInteger> exponents) {
+    if (bases.size() != exponents.size()) {
+      throw std::invalid_argument("multi_pow takes an exponent for every base");
+    }
+    std::vector<BasicModuledBigInt> signed_bases;
+    std::vector<std::span<const uint64_t>> magnitudes;
+    for (size_t i = 0; i < bases.size(); ++i) {
+      signed_bases.push_back(signed_base(bases[i], exponents[i]));
+      magnitudes.push_back(exponents[i].get_limbs());
+    }
+    return Exponent::interleaved<BasicModuledBigInt>(
+        signed_bases, magnitudes, BasicModuledBigInt(1), multiply, square_of);
+  }
+
+  friend std::ostream& operator<<(std::ostream& os,
+                                  const BasicModuledBigInt& a) {
+    return os << BigInteger(a.get_value());
+  }
+
+  // the residue below N, out of the Montgomery form
+  Value get_value() const { return N.from_montgomery(montgomery); }
+
+ private:
+  static Value negated(const Value& value) {
+    return value.is_zero() ? value : N.modulus() - value;
+  }
+
+  static BasicModuledBigInt multiply(const BasicModuledBigInt& a,
+                                     const BasicModuledBigInt& b) {
+    return a * b;
+  }
+  static BasicModuledBigInt square_of(const BasicModuledBigInt& a) {
+    return a.square();
+  }
+  static BasicModuledBigInt signed_base(const BasicModuledBigInt& base,
+                                        const BigInteger& exponent) {
+    if (!exponent.is_negative()) {
+      return base;
+    }
+    BasicModuledBigInt inverse = base.inversed();
+    if (inverse == BasicModuledBigInt()) {
+      throw std::domain_error("ModuledBigInt has no inverse");
+    }
+    return inverse;
+  }
+
+  // the residue times 2^Bits modulo N
+  Value montgomery;
+};
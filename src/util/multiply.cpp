@@ -0,0 +1,724 @@
+#include "multiply.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <compare>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "fft.hpp"
+#include "kernels.hpp"
+#include "ntt.hpp"
+#include "parallel.hpp"
+#include "thresholds.hpp"
+
+namespace {
+__extension__ typedef unsigned __int128 double_limb_t;
+
+std::atomic<Multiply::Engine> large_engine = Multiply::Engine::kNTT;
+
+size_t trimmed_size(const uint64_t* a, size_t size) {
+  while (size > 0 && a[size - 1] == 0) {
+    --size;
+  }
+  return size;
+}
+
+// res = a + b, res must have max(a_size, b_size) limbs, returns the carry
+uint64_t add(const uint64_t* a, size_t a_size, const uint64_t* b,
+             size_t b_size, uint64_t* res) {
+  if (a_size < b_size) {
+    std::swap(a, b);
+    std::swap(a_size, b_size);
+  }
+  uint64_t carry = Kernels::add_n(res, a, b, b_size);
+  for (size_t i = b_size; i < a_size; ++i) {
+    res[i] = a[i] + carry;
+    carry = res[i] < carry;
+  }
+  return carry;
+}
+
+// res += a, the sum must fit into res_size limbs
+void add_to(uint64_t* res, size_t res_size, const uint64_t* a,
+            size_t a_size) {
+  uint64_t carry = Kernels::add_n(res, res, a, a_size);
+  for (size_t i = a_size; carry != 0 && i < res_size; ++i) {
+    carry = ++res[i] == 0;
+  }
+}
+
+// res -= a, res must be not less than a
+void sub_from(uint64_t* res, const uint64_t* a, size_t a_size) {
+  uint64_t borrow = Kernels::sub_n(res, res, a, a_size);
+  for (size_t i = a_size; borrow != 0; ++i) {
+    borrow = res[i]-- == 0;
+  }
+}
+
+std::strong_ordering compare(const uint64_t* a, size_t a_size,
+                             const uint64_t* b, size_t b_size) {
+  a_size = trimmed_size(a, a_size);
+  b_size = trimmed_size(b, b_size);
+  if (a_size != b_size) {
+    return a_size <=> b_size;
+  }
+  for (size_t i = a_size; i > 0; --i) {
+    if (a[i - 1] != b[i - 1]) {
+      return a[i - 1] <=> b[i - 1];
+    }
+  }
+  return std::strong_ordering::equal;
+}
+
+// signed value of the Toom-3 evaluation and interpolation, in a fixed
+// number of limbs of the scratch space
+struct SignedLimbs {
+  uint64_t* limbs;
+  size_t size;
+  bool negative = false;
+};
+
+// x += y or x -= y for y not longer than x, the result must fit into x
+void add(SignedLimbs& x, const uint64_t* y, size_t y_size, bool y_negative) {
+  y_size = trimmed_size(y, y_size);
+  if (x.negative == y_negative) {
+    add_to(x.limbs, x.size, y, y_size);
+  } else if (compare(x.limbs, x.size, y, y_size) !=
+             std::strong_ordering::less) {
+    sub_from(x.limbs, y, y_size);
+  } else {
+    // |x| < |y|, so x has no limbs above y_size
+    Kernels::sub_n(x.limbs, y, x.limbs, y_size);
+    x.negative = y_negative;
+  }
+  if (trimmed_size(x.limbs, x.size) == 0) {
+    x.negative = false;
+  }
+}
+
+void add(SignedLimbs& x, const SignedLimbs& y) {
+  add(x, y.limbs, y.size, y.negative);
+}
+
+void sub(SignedLimbs& x, const SignedLimbs& y) {
+  add(x, y.limbs, y.size, !y.negative);
+}
+
+// the value must be even
+void halve(SignedLimbs& a) {
+  for (size_t i = 0; i < a.size; ++i) {
+    a.limbs[i] >>= 1;
+    if (i + 1 < a.size) {
+      a.limbs[i] |= a.limbs[i + 1] << 63;
+    }
+  }
+}
+
+// the value must be divisible by 3
+void divide_by_3(SignedLimbs& a) {
+  uint64_t remainder = 0;
+  for (size_t i = a.size; i > 0; --i) {
+    double_limb_t cur = (double_limb_t(remainder) << 64) | a.limbs[i - 1];
+    a.limbs[i - 1] = uint64_t(cur / 3);
+    remainder = uint64_t(cur % 3);
+  }
+}
+
+// values of a2 * x^2 + a1 * x + a0 in 1, -1, -2, where a_i are the parts of
+// k limbs, in 3 * (k + 1) limbs of buffer; the values in 0 and inf are the
+// parts a0 and a2 themselves
+std::array<SignedLimbs, 3> toom3_evaluate(const uint64_t* a, size_t size,
+                                          size_t k, uint64_t* buffer) {
+  const uint64_t* a1 = a + k;
+  const uint64_t* a2 = a + 2 * k;
+  size_t a1_size = std::min(size - k, k);
+  size_t a2_size = size - k - a1_size;
+  std::fill(buffer, buffer + 3 * (k + 1), 0);
+  SignedLimbs at_1{buffer, k + 1};
+  SignedLimbs at_m1{buffer + k + 1, k + 1};
+  SignedLimbs at_m2{buffer + 2 * (k + 1), k + 1};
+  std::copy(a, a + k, at_1.limbs);
+  add(at_1, a2, a2_size, false);
+  std::copy(at_1.limbs, at_1.limbs + k + 1, at_m1.limbs);
+  add(at_m1, a1, a1_size, true);
+  add(at_1, a1, a1_size, false);
+  // 2 * (a0 - a1 + 2 * a2) - a0
+  std::copy(at_m1.limbs, at_m1.limbs + k + 1, at_m2.limbs);
+  at_m2.negative = at_m1.negative;
+  add(at_m2, a2, a2_size, false);
+  add(at_m2, at_m2);
+  add(at_m2, a, k, true);
+  return {at_1, at_m1, at_m2};
+}
+
+// the product of the polynomials from its values in 1, -1, -2 and from the
+// products in 0 and inf, which are already in res at 0 and 4 * k, with the
+// interpolation sequence by M. Bodrato; the values are overwritten
+void toom3_interpolate(std::array<SignedLimbs, 3>& w, size_t k,
+                       size_t inf_size, uint64_t* res, size_t res_size) {
+  auto& [r1, r2, r3] = w;
+  const uint64_t* at_0 = res;
+  const uint64_t* at_inf = res + 4 * k;
+  std::fill(res + 2 * k, res + res_size - inf_size, 0);
+  sub(r3, r1);
+  divide_by_3(r3);
+  sub(r1, r2);
+  halve(r1);
+  add(r2, at_0, 2 * k, true);
+  r3.negative = !r3.negative;
+  add(r3, r2);
+  halve(r3);
+  add(r3, at_inf, inf_size, false);
+  add(r3, at_inf, inf_size, false);
+  add(r2, r1);
+  add(r2, at_inf, inf_size, true);
+  sub(r1, r3);
+  for (size_t i = 1; i < 4; ++i) {
+    size_t size = trimmed_size(w[i - 1].limbs, w[i - 1].size);
+    if (size != 0) {
+      add_to(res + i * k, res_size - i * k, w[i - 1].limbs, size);
+    }
+  }
+}
+
+size_t pieces_count(size_t size, unsigned bits) {
+  return (size * 64 + bits - 1) / bits;
+}
+
+// the number split into pieces of the given number of bits, which is
+// less than 64
+void split_into_pieces(const uint64_t* limbs, size_t size, unsigned bits,
+                       double* pieces) {
+  uint64_t mask = (uint64_t(1) << bits) - 1;
+  for (size_t i = 0; i < pieces_count(size, bits); ++i) {
+    size_t position = i * bits;
+    size_t limb = position / 64;
+    unsigned shift = position % 64;
+    uint64_t value = limbs[limb] >> shift;
+    if (shift + bits > 64 && limb + 1 < size) {
+      value |= limbs[limb + 1] << (64 - shift);
+    }
+    pieces[i] = double(value & mask);
+  }
+}
+
+// the product of the pieces back in limbs, the coefficients are rounded
+// to the nearest integers
+void join_pieces(const double* product, size_t product_size, unsigned bits,
+                 uint64_t* res, size_t res_size) {
+  double_limb_t carry = 0;
+  size_t next = 0;
+  for (size_t i = 0; i < res_size; ++i) {
+    // the coefficients starting in this limb, they are below 2^53
+    for (; next < product_size && next * bits < (i + 1) * 64; ++next) {
+      carry += double_limb_t(uint64_t(product[next] + 0.5))
+               << (next * bits - i * 64);
+    }
+    res[i] = uint64_t(carry);
+    carry >>= 64;
+  }
+}
+
+std::vector<uint32_t> split_into_halves(const uint64_t* limbs, size_t size) {
+  std::vector<uint32_t> halves(2 * size);
+  for (size_t i = 0; i < 2 * size; ++i) {
+    halves[i] = uint32_t(limbs[i / 2] >> (i % 2 * 32));
+  }
+  return halves;
+}
+
+// the product of the 32-bit halves back in limbs
+void join_halves(const std::vector<double_limb_t>& product, uint64_t* res,
+                 size_t res_size) {
+  double_limb_t carry = 0;
+  for (size_t i = 0; i < res_size; ++i) {
+    if (2 * i < product.size()) {
+      carry += product[2 * i];
+    }
+    // the coefficients are below 2^89, so this does not overflow
+    if (2 * i + 1 < product.size()) {
+      carry += product[2 * i + 1] << 32;
+    }
+    res[i] = uint64_t(carry);
+    carry >>= 64;
+  }
+}
+
+bool is_parallel(size_t size) {
+  return size >= Thresholds::current().parallel &&
+         Parallel::get_threads() > 1;
+}
+
+// calls the products as product(scratch), in parallel for operands of size
+// limbs long enough for that; one after another they share the scratch,
+// which has scratch_size limbs, and in parallel each allocates its own
+template <typename... Products>
+void run_products(size_t size, uint64_t* scratch, size_t scratch_size,
+                  Products&&... products) {
+  if (is_parallel(size)) {
+    Parallel::run({std::function<void()>([&products, scratch_size] {
+      std::vector<uint64_t> own(scratch_size);
+      products(own.data());
+    })...});
+  } else {
+    (products(scratch), ...);
+  }
+}
+
+// res = a * b with a cut into blocks of block_size limbs, every block is
+// multiplied by b with product(block, length, out) into the buffer of
+// block_size + b_size limbs
+template <typename Product>
+void multiply_by_blocks(const uint64_t* a, size_t a_size, size_t b_size,
+                        size_t block_size, uint64_t* res, uint64_t* buffer,
+                        Product product) {
+  std::fill(res, res + a_size + b_size, 0);
+  for (size_t start = 0; start < a_size; start += block_size) {
+    size_t len = std::min(block_size, a_size - start);
+    product(a + start, len, buffer);
+    add_to(res + start, a_size + b_size - start, buffer, len + b_size);
+  }
+}
+
+// The length of the blocks of a for the products by the large engine with
+// a single transform of b, or a_size if one product of the whole operands
+// is cheaper and fits the engine. A transform of size t costs t log t;
+// every block takes a forward and an inverse transform, and larger
+// transforms take longer blocks, so the block length is picked among the
+// sizes of the transform by that cost.
+size_t transform_block_size(Multiply::Engine engine, size_t a_size,
+                            size_t b_size) {
+  double coefficients_per_limb = 2;
+  // in transforms of the product size: the NTT transforms both operands and
+  // the product; the FFT packs both operands into one transform, and the
+  // product and single operands take a transform of half the size
+  double product_transforms = 3;
+  double operand_transforms = 1;
+  bool whole_fits = 2 * (a_size + b_size) <= NTT::MAX_SIZE;
+  if (engine == Multiply::Engine::kFFT) {
+    unsigned bits = FFT::piece_bits(a_size * 64, b_size * 64);
+    coefficients_per_limb = 64.0 / (bits ? bits : FFT::MIN_PIECE_BITS);
+    product_transforms = 1.5;
+    operand_transforms = 0.5;
+    whole_fits = bits != 0;
+  }
+  auto cost = [](size_t size) { return double(size) * std::bit_width(size); };
+  size_t whole = FFT::transform_size(
+      size_t(coefficients_per_limb * double(a_size + b_size)));
+  // without a whole product the blocks are at most as long as b, the
+  // products of which are split further if needed
+  size_t best_size = whole_fits ? a_size : b_size;
+  double best_cost = whole_fits ? product_transforms * cost(whole)
+                                : std::numeric_limits<double>::infinity();
+  for (size_t size = FFT::transform_size(
+           size_t(coefficients_per_limb * double(2 * b_size)));
+       size < whole && size <= NTT::MAX_SIZE; size *= 2) {
+    // one limb less, so that the rounding never takes the next size
+    size_t len = size_t(double(size) / coefficients_per_limb) - b_size - 1;
+    size_t blocks = (a_size + len - 1) / len;
+    double blocks_cost =
+        cost(size) * operand_transforms * double(1 + 2 * blocks);
+    if (blocks_cost < best_cost) {
+      best_cost = blocks_cost;
+      best_size = len;
+    }
+  }
+  return best_size;
+}
+
+// a is at least UNBALANCED_RATIO times as long as b; scratch has
+// 2 * b_size + scratch_size(b_size) limbs
+void multiply_unbalanced(const uint64_t* a, size_t a_size, const uint64_t* b,
+                         size_t b_size, uint64_t* res, uint64_t* scratch) {
+  using Multiply::Engine;
+  Engine engine = Multiply::get_large_engine();
+  size_t threshold = engine == Engine::kNTT ? Thresholds::current().ntt
+                                            : Thresholds::current().fft;
+  if (b_size >= threshold) {
+    size_t block_size = transform_block_size(engine, a_size, b_size);
+    if (block_size >= a_size) {
+      if (engine == Engine::kNTT) {
+        Multiply::ntt(a, a_size, b, b_size, res);
+      } else {
+        Multiply::fft(a, a_size, b, b_size, res);
+      }
+      return;
+    }
+    Multiply::Prepared prepared(b, b_size, block_size);
+    if (prepared.is_transformed()) {
+      prepared.multiply(a, a_size, b, b_size, res);
+      return;
+    }
+  }
+  multiply_by_blocks(a, a_size, b_size, b_size, res, scratch,
+                     [&](const uint64_t* block, size_t len, uint64_t* out) {
+                       Multiply::multiply(block, len, b, b_size, out,
+                                          scratch + 2 * b_size);
+                     });
+}
+}  // namespace
+
+namespace Multiply {
+void set_large_engine(Engine engine) { large_engine = engine; }
+
+Engine get_large_engine() { return large_engine; }
+
+// a level of Karatsuba takes 2 * size limbs for its sums and its middle
+// product and Toom-3 4 * size for its values and products, and they pass
+// operands of half and a third of the size down; the bound is the largest
+// sum over the levels, checked for every size up to 400000
+size_t scratch_size(size_t size) { return 8 * size + 40; }
+
+size_t multiply_scratch_size(size_t a_size, size_t b_size) {
+  size_t shorter = std::min(a_size, b_size);
+  if (shorter < Thresholds::current().karatsuba) {
+    return 0;
+  }
+  if (std::max(a_size, b_size) >= UNBALANCED_RATIO * shorter) {
+    return 2 * shorter + scratch_size(shorter);
+  }
+  return scratch_size(std::max(a_size, b_size));
+}
+
+size_t square_scratch_size(size_t size) {
+  return size < Thresholds::current().karatsuba_square ? 0
+                                                        : scratch_size(size);
+}
+
+void multiply(const uint64_t* a, size_t a_size, const uint64_t* b,
+              size_t b_size, uint64_t* res) {
+  std::vector<uint64_t> scratch(multiply_scratch_size(a_size, b_size));
+  multiply(a, a_size, b, b_size, res, scratch.data());
+}
+
+void multiply(const uint64_t* a, size_t a_size, const uint64_t* b,
+              size_t b_size, uint64_t* res, uint64_t* scratch) {
+  if (a_size < b_size) {
+    std::swap(a, b);
+    std::swap(a_size, b_size);
+  }
+  Engine engine = get_large_engine();
+  const Thresholds& thresholds = Thresholds::current();
+  if (b_size < thresholds.karatsuba) {
+    schoolbook(a, a_size, b, b_size, res);
+  } else if (a_size >= UNBALANCED_RATIO * b_size) {
+    multiply_unbalanced(a, a_size, b, b_size, res, scratch);
+  } else if (engine == Engine::kNTT && b_size >= thresholds.ntt) {
+    ntt(a, a_size, b, b_size, res);
+  } else if (engine == Engine::kFFT && b_size >= thresholds.fft) {
+    fft(a, a_size, b, b_size, res);
+  } else if (b_size < thresholds.toom3) {
+    karatsuba(a, a_size, b, b_size, res, scratch);
+  } else {
+    toom3(a, a_size, b, b_size, res, scratch);
+  }
+}
+
+void schoolbook(const uint64_t* a, size_t a_size, const uint64_t* b,
+                size_t b_size, uint64_t* res) {
+  std::fill(res, res + a_size + b_size, 0);
+  for (size_t i = 0; i < a_size; ++i) {
+    res[i + b_size] = Kernels::addmul_1(res + i, b, b_size, a[i]);
+  }
+}
+
+/*
+ * a = a1 * B^h + a0, b = b1 * B^h + b0
+ * a * b = a1 * b1 * B^2h + ((a0 + a1)(b0 + b1) - a0 * b0 - a1 * b1) * B^h
+ *         + a0 * b0
+ */
+void karatsuba(const uint64_t* a, size_t a_size, const uint64_t* b,
+               size_t b_size, uint64_t* res, uint64_t* scratch) {
+  if (a_size < b_size) {
+    std::swap(a, b);
+    std::swap(a_size, b_size);
+  }
+  size_t h = (a_size + 1) / 2;
+  if (b_size <= h) {
+    // b has no high part
+    multiply_unbalanced(a, a_size, b, b_size, res, scratch);
+    return;
+  }
+  size_t a1_size = a_size - h;
+  size_t b1_size = b_size - h;
+  uint64_t* a_sum = scratch;
+  uint64_t* b_sum = a_sum + h + 1;
+  uint64_t* middle = b_sum + h + 1;
+  a_sum[h] = add(a, h, a + h, a1_size, a_sum);
+  b_sum[h] = add(b, h, b + h, b1_size, b_sum);
+  run_products(
+      b_size, middle + 2 * h + 2, scratch_size(h + 1),
+      [&](uint64_t* rest) { multiply(a, h, b, h, res, rest); },
+      [&](uint64_t* rest) {
+        multiply(a + h, a1_size, b + h, b1_size, res + 2 * h, rest);
+      },
+      [&](uint64_t* rest) {
+        multiply(a_sum, h + 1, b_sum, h + 1, middle, rest);
+      });
+  sub_from(middle, res, 2 * h);
+  sub_from(middle, res + 2 * h, a1_size + b1_size);
+  add_to(res + h, a_size + b_size - h, middle,
+         trimmed_size(middle, 2 * h + 2));
+}
+
+/*
+ * a = a2 * x^2 + a1 * x + a0 with x = B^k, the same for b
+ * the product is evaluated in 0, 1, -1, -2, inf and interpolated
+ */
+void toom3(const uint64_t* a, size_t a_size, const uint64_t* b,
+           size_t b_size, uint64_t* res, uint64_t* scratch) {
+  if (a_size < b_size) {
+    std::swap(a, b);
+    std::swap(a_size, b_size);
+  }
+  size_t k = (a_size + 2) / 3;
+  if (b_size <= k) {
+    multiply_unbalanced(a, a_size, b, b_size, res, scratch);
+    return;
+  }
+  auto a_values = toom3_evaluate(a, a_size, k, scratch);
+  auto b_values = toom3_evaluate(b, b_size, k, scratch + 3 * (k + 1));
+  // the products in 1, -1, -2 go to the scratch, the ones in 0 and inf
+  // right to their places in res
+  uint64_t* products = scratch + 6 * (k + 1);
+  std::array<SignedLimbs, 3> w;
+  for (size_t i = 0; i < 3; ++i) {
+    w[i] = {products + i * (2 * k + 2), 2 * k + 2,
+            a_values[i].negative != b_values[i].negative};
+  }
+  size_t inf_size = b_size > 2 * k ? a_size + b_size - 4 * k : 0;
+  auto product = [&](size_t i) {
+    return [&, i](uint64_t* rest) {
+      multiply(a_values[i].limbs, k + 1, b_values[i].limbs, k + 1,
+               w[i].limbs, rest);
+    };
+  };
+  run_products(
+      b_size, products + 6 * (k + 1), scratch_size(k + 1),
+      [&](uint64_t* rest) { multiply(a, k, b, k, res, rest); }, product(0),
+      product(1), product(2), [&](uint64_t* rest) {
+        if (inf_size != 0) {
+          multiply(a + 2 * k, a_size - 2 * k, b + 2 * k, b_size - 2 * k,
+                   res + 4 * k, rest);
+        }
+      });
+  toom3_interpolate(w, k, inf_size, res, a_size + b_size);
+}
+
+void fft(const uint64_t* a, size_t a_size, const uint64_t* b, size_t b_size,
+         uint64_t* res) {
+  unsigned bits = FFT::piece_bits(a_size * 64, b_size * 64);
+  if (bits == 0) {
+    // too long to be exact, karatsuba splits it into halves
+    std::vector<uint64_t> scratch(scratch_size(std::max(a_size, b_size)));
+    karatsuba(a, a_size, b, b_size, res, scratch.data());
+    return;
+  }
+  size_t a_pieces = pieces_count(a_size, bits);
+  size_t b_pieces = pieces_count(b_size, bits);
+  size_t product_size = a_pieces + b_pieces - 1;
+  FFT::Plan& plan = FFT::cached_plan(FFT::transform_size(product_size));
+  split_into_pieces(a, a_size, bits, plan.re());
+  split_into_pieces(b, b_size, bits, plan.im());
+  FFT::convolve(plan, a_pieces, b_pieces);
+  join_pieces(plan.re(), product_size, bits, res, a_size + b_size);
+}
+
+void ntt(const uint64_t* a, size_t a_size, const uint64_t* b, size_t b_size,
+         uint64_t* res) {
+  if (2 * (a_size + b_size) > NTT::MAX_SIZE) {
+    // too long for a single transform, karatsuba splits it into halves
+    // which are multiplied here again
+    std::vector<uint64_t> scratch(scratch_size(std::max(a_size, b_size)));
+    karatsuba(a, a_size, b, b_size, res, scratch.data());
+    return;
+  }
+  join_halves(NTT::multiply_poly(split_into_halves(a, a_size),
+                                 split_into_halves(b, b_size),
+                                 is_parallel(b_size)),
+              res, a_size + b_size);
+}
+
+void square(const uint64_t* a, size_t size, uint64_t* res) {
+  std::vector<uint64_t> scratch(square_scratch_size(size));
+  square(a, size, res, scratch.data());
+}
+
+void square(const uint64_t* a, size_t size, uint64_t* res,
+            uint64_t* scratch) {
+  Engine engine = get_large_engine();
+  const Thresholds& thresholds = Thresholds::current();
+  if (size < thresholds.karatsuba_square) {
+    schoolbook_square(a, size, res);
+  } else if (engine == Engine::kNTT && size >= thresholds.ntt_square) {
+    ntt_square(a, size, res);
+  } else if (engine == Engine::kFFT && size >= thresholds.fft_square) {
+    fft_square(a, size, res);
+  } else if (size < thresholds.toom3_square) {
+    karatsuba_square(a, size, res, scratch);
+  } else {
+    toom3_square(a, size, res, scratch);
+  }
+}
+
+// every product a_i * a_j with i < j is computed once and doubled
+void schoolbook_square(const uint64_t* a, size_t size, uint64_t* res) {
+  std::fill(res, res + 2 * size, 0);
+  for (size_t i = 0; i < size; ++i) {
+    res[i + size] =
+        Kernels::addmul_1(res + 2 * i + 1, a + i + 1, size - i - 1, a[i]);
+  }
+  uint64_t top_bit = 0;
+  for (size_t i = 0; i < 2 * size; ++i) {
+    uint64_t next_top_bit = res[i] >> 63;
+    res[i] = (res[i] << 1) | top_bit;
+    top_bit = next_top_bit;
+  }
+  uint64_t carry = 0;
+  for (size_t i = 0; i < size; ++i) {
+    double_limb_t diagonal = double_limb_t(a[i]) * a[i];
+    double_limb_t low = double_limb_t(res[2 * i]) + uint64_t(diagonal) + carry;
+    res[2 * i] = uint64_t(low);
+    double_limb_t high = double_limb_t(res[2 * i + 1]) +
+                         uint64_t(diagonal >> 64) + uint64_t(low >> 64);
+    res[2 * i + 1] = uint64_t(high);
+    carry = uint64_t(high >> 64);
+  }
+}
+
+// a^2 = a1^2 * B^2h + ((a0 + a1)^2 - a0^2 - a1^2) * B^h + a0^2
+void karatsuba_square(const uint64_t* a, size_t size, uint64_t* res,
+                      uint64_t* scratch) {
+  size_t h = (size + 1) / 2;
+  size_t a1_size = size - h;
+  uint64_t* a_sum = scratch;
+  uint64_t* middle = a_sum + h + 1;
+  a_sum[h] = add(a, h, a + h, a1_size, a_sum);
+  run_products(
+      size, middle + 2 * h + 2, scratch_size(h + 1),
+      [&](uint64_t* rest) { square(a, h, res, rest); },
+      [&](uint64_t* rest) { square(a + h, a1_size, res + 2 * h, rest); },
+      [&](uint64_t* rest) { square(a_sum, h + 1, middle, rest); });
+  sub_from(middle, res, 2 * h);
+  sub_from(middle, res + 2 * h, 2 * a1_size);
+  add_to(res + h, 2 * size - h, middle, trimmed_size(middle, 2 * h + 2));
+}
+
+void toom3_square(const uint64_t* a, size_t size, uint64_t* res,
+                  uint64_t* scratch) {
+  size_t k = (size + 2) / 3;
+  auto values = toom3_evaluate(a, size, k, scratch);
+  uint64_t* products = scratch + 3 * (k + 1);
+  std::array<SignedLimbs, 3> w;
+  for (size_t i = 0; i < 3; ++i) {
+    w[i] = {products + i * (2 * k + 2), 2 * k + 2};
+  }
+  size_t inf_size = size > 2 * k ? 2 * (size - 2 * k) : 0;
+  auto product = [&](size_t i) {
+    return [&, i](uint64_t* rest) {
+      square(values[i].limbs, k + 1, w[i].limbs, rest);
+    };
+  };
+  run_products(
+      size, products + 6 * (k + 1), scratch_size(k + 1),
+      [&](uint64_t* rest) { square(a, k, res, rest); }, product(0),
+      product(1), product(2), [&](uint64_t* rest) {
+        if (inf_size != 0) {
+          square(a + 2 * k, size - 2 * k, res + 4 * k, rest);
+        }
+      });
+  toom3_interpolate(w, k, inf_size, res, 2 * size);
+}
+
+void fft_square(const uint64_t* a, size_t size, uint64_t* res) {
+  unsigned bits = FFT::piece_bits(size * 64, size * 64);
+  if (bits == 0) {
+    std::vector<uint64_t> scratch(scratch_size(size));
+    karatsuba_square(a, size, res, scratch.data());
+    return;
+  }
+  size_t pieces = pieces_count(size, bits);
+  FFT::Plan& plan = FFT::cached_plan(FFT::transform_size(2 * pieces - 1));
+  split_into_pieces(a, size, bits, plan.re());
+  FFT::square(plan, pieces);
+  join_pieces(plan.re(), 2 * pieces - 1, bits, res, 2 * size);
+}
+
+void ntt_square(const uint64_t* a, size_t size, uint64_t* res) {
+  if (4 * size > NTT::MAX_SIZE) {
+    std::vector<uint64_t> scratch(scratch_size(size));
+    karatsuba_square(a, size, res, scratch.data());
+    return;
+  }
+  join_halves(NTT::square_poly(split_into_halves(a, size), is_parallel(size)),
+              res, 2 * size);
+}
+
+Prepared::Prepared(const uint64_t* b, size_t b_size, size_t max_other_size)
+    : engine(get_large_engine()), max_other_size(max_other_size) {
+  if (engine == Engine::kNTT) {
+    if (std::min(b_size, max_other_size) < Thresholds::current().ntt ||
+        2 * (b_size + max_other_size) > NTT::MAX_SIZE) {
+      return;
+    }
+    transform_size =
+        FFT::transform_size(2 * (b_size + max_other_size) - 1);
+    residues = NTT::transform(split_into_halves(b, b_size), transform_size,
+                              is_parallel(std::min(b_size, max_other_size)));
+    return;
+  }
+  if (std::min(b_size, max_other_size) < Thresholds::current().fft) {
+    return;
+  }
+  // pieces exact for the longest operand are exact for the shorter ones
+  piece_bits = FFT::piece_bits(max_other_size * 64, b_size * 64);
+  if (piece_bits == 0) {
+    return;
+  }
+  size_t b_pieces = pieces_count(b_size, piece_bits);
+  transform_size = FFT::transform_size(
+      pieces_count(max_other_size, piece_bits) + b_pieces - 1);
+  FFT::Plan& plan = FFT::cached_plan(transform_size);
+  split_into_pieces(b, b_size, piece_bits, plan.re());
+  norm = FFT::norm(plan.re(), b_pieces);
+  FFT::transform(plan, b_pieces);
+  spectrum.assign(plan.re(), plan.re() + transform_size);
+  spectrum.insert(spectrum.end(), plan.im(), plan.im() + transform_size);
+}
+
+void Prepared::multiply(const uint64_t* a, size_t a_size, const uint64_t* b,
+                        size_t b_size, uint64_t* res) const {
+  size_t threshold = engine == Engine::kNTT ? Thresholds::current().ntt
+                                            : Thresholds::current().fft;
+  if (!is_transformed() || a_size < threshold) {
+    Multiply::multiply(a, a_size, b, b_size, res);
+    return;
+  }
+  if (a_size > max_other_size) {
+    std::vector<uint64_t> buffer(max_other_size + b_size);
+    multiply_by_blocks(a, a_size, b_size, max_other_size, res, buffer.data(),
+                       [&](const uint64_t* block, size_t len, uint64_t* out) {
+                         multiply(block, len, b, b_size, out);
+                       });
+    return;
+  }
+  if (engine == Engine::kNTT) {
+    join_halves(NTT::multiply_poly(split_into_halves(a, a_size), residues,
+                                   2 * (a_size + b_size) - 1,
+                                   is_parallel(std::min(a_size, b_size))),
+                res, a_size + b_size);
+    return;
+  }
+  size_t a_pieces = pieces_count(a_size, piece_bits);
+  size_t product_size = a_pieces + pieces_count(b_size, piece_bits) - 1;
+  FFT::Plan& plan = FFT::cached_plan(transform_size);
+  split_into_pieces(a, a_size, piece_bits, plan.re());
+  FFT::convolve(plan, a_pieces, spectrum.data(),
+                spectrum.data() + transform_size, norm);
+  join_pieces(plan.re(), product_size, piece_bits, res, a_size + b_size);
+}
+}  // namespace Multiply
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ntt.hpp"
+
+/*
+ * Multiplication of non-negative numbers given as arrays of 64-bit limbs,
+ * least significant limb first. res must have a_size + b_size limbs and
+ * must not overlap with the operands. The sizes at which the algorithms
+ * switch are in Thresholds::current().
+ *
+ * Karatsuba and Toom-3 keep their sums and products in the scratch space
+ * of the caller, passed down the recursion, in the manner of GMP. The
+ * transforms take their own memory, and so do the products run in
+ * parallel.
+ */
+namespace Multiply {
+// operands that differ in length at least that many times are multiplied
+// by blocks of the longer one, with a single transform of the shorter one
+// when it is long enough for the large engine
+const size_t UNBALANCED_RATIO = 2;
+
+// algorithm used for the largest operands
+enum class Engine {
+  kFFT,  // double complex FFT with pieces narrow enough to be exact
+  kNTT   // exact three-prime number-theoretic transform
+};
+
+void set_large_engine(Engine);
+Engine get_large_engine();
+
+// the scratch space in limbs of karatsuba, toom3 and their squares for
+// operands of at most size limbs
+size_t scratch_size(size_t size);
+// the scratch space of multiply() and square() with the current thresholds,
+// 0 for the schoolbook sizes
+size_t multiply_scratch_size(size_t a_size, size_t b_size);
+size_t square_scratch_size(size_t size);
+
+// picks the algorithm by the sizes of the operands; scratch has
+// multiply_scratch_size(a_size, b_size) limbs, the overload without it
+// allocates them
+void multiply(const uint64_t* a, size_t a_size, const uint64_t* b,
+              size_t b_size, uint64_t* res, uint64_t* scratch);
+void multiply(const uint64_t* a, size_t a_size, const uint64_t* b,
+              size_t b_size, uint64_t* res);
+
+void schoolbook(const uint64_t* a, size_t a_size, const uint64_t* b,
+                size_t b_size, uint64_t* res);
+// scratch has scratch_size(max(a_size, b_size)) limbs
+void karatsuba(const uint64_t* a, size_t a_size, const uint64_t* b,
+               size_t b_size, uint64_t* res, uint64_t* scratch);
+void toom3(const uint64_t* a, size_t a_size, const uint64_t* b,
+           size_t b_size, uint64_t* res, uint64_t* scratch);
+void fft(const uint64_t* a, size_t a_size, const uint64_t* b, size_t b_size,
+         uint64_t* res);
+void ntt(const uint64_t* a, size_t a_size, const uint64_t* b, size_t b_size,
+         uint64_t* res);
+
+/*
+ * The forward transform of an operand that takes part in many products,
+ * like a key or a modulus, so that a product with it needs one forward and
+ * one inverse transform instead of two forward ones and an inverse one.
+ * The transform is made by the large engine set at the construction and
+ * only for operands long enough for that engine; the operand itself is not
+ * copied and is passed to every product.
+ */
+class Prepared {
+ public:
+  Prepared() = default;
+  // the transform fits products with operands of up to max_other_size limbs
+  Prepared(const uint64_t* b, size_t b_size, size_t max_other_size);
+
+  bool is_transformed() const { return transform_size != 0; }
+
+  // res = a * b, b must be the operand this was made from; operands too
+  // short for the engine are multiplied the usual way, and the ones longer
+  // than max_other_size by blocks that fit the transform
+  void multiply(const uint64_t* a, size_t a_size, const uint64_t* b,
+                size_t b_size, uint64_t* res) const;
+
+ private:
+  Engine engine = Engine::kNTT;
+  size_t max_other_size = 0;
+  // 0 if there is no transform
+  size_t transform_size = 0;
+  NTT::Transformed residues;
+  // the FFT transform: the piece width, the real and the imaginary parts
+  // and the norm of the pieces
+  unsigned piece_bits = 0;
+  std::vector<double> spectrum;
+  double norm = 0;
+};
+
+// a^2 using the symmetry of the product, res must have 2 * size limbs;
+// scratch has square_scratch_size(size) limbs
+void square(const uint64_t* a, size_t size, uint64_t* res,
+            uint64_t* scratch);
+void square(const uint64_t* a, size_t size, uint64_t* res);
+
+void schoolbook_square(const uint64_t* a, size_t size, uint64_t* res);
+// scratch has scratch_size(size) limbs
+void karatsuba_square(const uint64_t* a, size_t size, uint64_t* res,
+                      uint64_t* scratch);
+void toom3_square(const uint64_t* a, size_t size, uint64_t* res,
+                  uint64_t* scratch);
+void fft_square(const uint64_t* a, size_t size, uint64_t* res);
+void ntt_square(const uint64_t* a, size_t size, uint64_t* res);
+}  // namespace Multiply
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "parallel.hpp"
+
+/*
+ * Number-theoretic transform modulo three primes of the form c * 2^k + 1.
+ * Products of polynomials with coefficients below 2^32 are computed modulo
+ * each prime and recombined with the chinese remainder theorem, which is
+ * exact as long as every coefficient of the product is below
+ * P1 * P2 * P3 > 2^89. A coefficient is at most min(n, m) * 2^64, so any
+ * transform up to MAX_SIZE fits.
+ */
+namespace NTT {
+__extension__ typedef unsigned __int128 uint128_t;
+
+const uint32_t P1 = 2013265921;  // 15 * 2^27 + 1
+const uint32_t P2 = 469762049;   // 7 * 2^26 + 1
+const uint32_t P3 = 754974721;   // 45 * 2^24 + 1
+
+// the largest power of two dividing every P - 1
+const size_t MAX_SIZE = size_t(1) << 24;
+
+template <uint32_t MOD>
+constexpr uint32_t power(uint32_t base, uint64_t exponent) {
+  uint64_t ans = 1;
+  uint64_t cur = base;
+  while (exponent) {
+    if (exponent & 1) {
+      ans = ans * cur % MOD;
+    }
+    cur = cur * cur % MOD;
+    exponent >>= 1;
+  }
+  return uint32_t(ans);
+}
+
+template <uint32_t MOD>
+constexpr uint32_t inverse(uint32_t value) {
+  return power<MOD>(value, MOD - 2);
+}
+
+// arithmetic modulo MOD in Montgomery form with R = 2^32
+template <uint32_t MOD>
+struct Montgomery {
+  // -MOD^(-1) modulo 2^32
+  static constexpr uint32_t NEG_INV = [] {
+    uint32_t inv = MOD;
+    for (int i = 0; i < 5; i++) inv *= 2 - MOD * inv;
+    return -inv;
+  }();
+  static constexpr uint32_t R2 = (uint128_t(1) << 64) % MOD;
+
+  // x * R^(-1) modulo MOD for x < MOD * 2^32
+  static uint32_t reduce(uint64_t x) {
+    uint32_t m = uint32_t(x) * NEG_INV;
+    uint32_t t = (x + uint64_t(m) * MOD) >> 32;
+    return t >= MOD ? t - MOD : t;
+  }
+
+  static uint32_t mul(uint32_t a, uint32_t b) {
+    return reduce(uint64_t(a) * b);
+  }
+  static uint32_t to(uint32_t a) { return mul(a % MOD, R2); }
+  static uint32_t from(uint32_t a) { return reduce(a); }
+  static uint32_t add(uint32_t a, uint32_t b) {
+    return a + b < MOD ? a + b : a + b - MOD;
+  }
+  static uint32_t sub(uint32_t a, uint32_t b) {
+    return a >= b ? a - b : a + MOD - b;
+  }
+};
+
+// roots[len + j] is the j-th power of the primitive root of degree 2 * len
+// in Montgomery form, or of its inverse
+template <uint32_t MOD, uint32_t ROOT>
+std::vector<uint32_t> roots_table(size_t n, bool invert) {
+  using M = Montgomery<MOD>;
+  std::vector<uint32_t> roots(std::max(n, size_t(2)));
+  for (size_t len = 1; len < n; len <<= 1) {
+    uint32_t root = power<MOD>(ROOT, (MOD - 1) / (2 * len));
+    if (invert) root = inverse<MOD>(root);
+    root = M::to(root);
+    roots[len] = M::to(1);
+    for (size_t j = 1; j < len; j++)
+      roots[len + j] = M::mul(roots[len + j - 1], root);
+  }
+  return roots;
+}
+
+/*
+ * Transforms of values in Montgomery form, the size of a must be a power
+ * of two not greater than MAX_SIZE. The forward transform leaves the result
+ * in bit-reversed order, and the inverse one takes it in that order, so
+ * no permutation is needed for multiplication.
+ */
+template <uint32_t MOD>
+void ntt_forward(std::vector<uint32_t> &a,
+                 const std::vector<uint32_t> &roots) {
+  using M = Montgomery<MOD>;
+  size_t n = a.size();
+  for (size_t len = n >> 1; len >= 1; len >>= 1)
+    for (size_t i = 0; i < n; i += (len << 1))
+      for (size_t j = 0; j < len; j++) {
+        uint32_t u = a[i + j];
+        uint32_t v = a[i + j + len];
+        a[i + j] = M::add(u, v);
+        a[i + j + len] = M::mul(M::sub(u, v), roots[len + j]);
+      }
+}
+
+// roots must be built for the inverse root, the result is multiplied by n
+template <uint32_t MOD>
+void ntt_inverse(std::vector<uint32_t> &a,
+                 const std::vector<uint32_t> &roots) {
+  using M = Montgomery<MOD>;
+  size_t n = a.size();
+  for (size_t len = 1; len < n; len <<= 1)
+    for (size_t i = 0; i < n; i += (len << 1))
+      for (size_t j = 0; j < len; j++) {
+        uint32_t u = a[i + j];
+        uint32_t v = M::mul(a[i + j + len], roots[len + j]);
+        a[i + j] = M::add(u, v);
+        a[i + j + len] = M::sub(u, v);
+      }
+}
+
+// the forward transform of a modulo MOD padded to size
+template <uint32_t MOD>
+std::vector<uint32_t> forward_mod(const std::vector<uint32_t> &a, size_t size,
+                                  const std::vector<uint32_t> &roots) {
+  using M = Montgomery<MOD>;
+  std::vector<uint32_t> fa(size);
+  for (size_t i = 0; i < a.size(); i++) fa[i] = M::to(a[i]);
+  ntt_forward<MOD>(fa, roots);
+  return fa;
+}
+
+// the product of the polynomials with forward transforms fa and fb
+// modulo MOD
+template <uint32_t MOD, uint32_t ROOT>
+std::vector<uint32_t> inverse_product(std::vector<uint32_t> fa,
+                                      const std::vector<uint32_t> &fb) {
+  using M = Montgomery<MOD>;
+  size_t size = fa.size();
+  // the size inverse is merged into the pointwise product
+  uint32_t scale = M::to(inverse<MOD>(size % MOD));
+  for (size_t i = 0; i < size; i++)
+    fa[i] = M::mul(M::mul(fa[i], fb[i]), scale);
+  ntt_inverse<MOD>(fa, roots_table<MOD, ROOT>(size, true));
+  for (auto &value : fa) value = M::from(value);
+  return fa;
+}
+
+// product of a and b modulo MOD padded to size
+template <uint32_t MOD, uint32_t ROOT>
+std::vector<uint32_t> multiply_mod(const std::vector<uint32_t> &a,
+                                   const std::vector<uint32_t> &b,
+                                   size_t size) {
+  auto roots = roots_table<MOD, ROOT>(size, false);
+  return inverse_product<MOD, ROOT>(forward_mod<MOD>(a, size, roots),
+                                    forward_mod<MOD>(b, size, roots));
+}
+
+// product of a and the polynomial with the forward transform fb modulo MOD,
+// padded to the size of the transform
+template <uint32_t MOD, uint32_t ROOT>
+std::vector<uint32_t> multiply_transformed_mod(
+    const std::vector<uint32_t> &a, const std::vector<uint32_t> &fb) {
+  size_t size = fb.size();
+  return inverse_product<MOD, ROOT>(
+      forward_mod<MOD>(a, size, roots_table<MOD, ROOT>(size, false)), fb);
+}
+
+// square of a modulo MOD padded to size, needs one forward transform
+template <uint32_t MOD, uint32_t ROOT>
+std::vector<uint32_t> square_mod(const std::vector<uint32_t> &a, size_t size) {
+  using M = Montgomery<MOD>;
+  std::vector<uint32_t> fa(size);
+  for (size_t i = 0; i < a.size(); i++) fa[i] = M::to(a[i]);
+  ntt_forward<MOD>(fa, roots_table<MOD, ROOT>(size, false));
+  uint32_t scale = M::to(inverse<MOD>(size % MOD));
+  for (size_t i = 0; i < size; i++)
+    fa[i] = M::mul(M::mul(fa[i], fa[i]), scale);
+  ntt_inverse<MOD>(fa, roots_table<MOD, ROOT>(size, true));
+  for (auto &value : fa) value = M::from(value);
+  return fa;
+}
+
+// the unique x < P1 * P2 * P3 with the given remainders
+inline uint128_t crt(uint32_t r1, uint32_t r2, uint32_t r3) {
+  static constexpr uint32_t P1_INV_MOD_P2 = inverse<P2>(P1 % P2);
+  static constexpr uint32_t P12_INV_MOD_P3 =
+      inverse<P3>(uint64_t(P1) * P2 % P3);
+
+  uint64_t x12 =
+      r1 + uint64_t(P1) *
+               (uint64_t(r2 + P2 - r1 % P2) * P1_INV_MOD_P2 % P2);
+  uint64_t x12_mod_p3 = x12 % P3;
+  uint64_t k = uint64_t(r3 + P3 - x12_mod_p3) * P12_INV_MOD_P3 % P3;
+  return x12 + uint128_t(uint64_t(P1) * P2) * k;
+}
+
+// calls the products modulo every prime, as tasks of the pool with
+// parallel set and one after another otherwise, without wrapping them
+template <typename... Products>
+inline void run_primes(bool parallel, Products &&...products) {
+  if (parallel) {
+    Parallel::run({std::function<void()>(products)...});
+  } else {
+    (products(), ...);
+  }
+}
+
+// exact product of polynomials with coefficients below 2^32,
+// n + m - 1 must not exceed MAX_SIZE; with parallel set the primes are
+// handled by different threads of the pool
+inline std::vector<uint128_t> multiply_poly(const std::vector<uint32_t> &a,
+                                            const std::vector<uint32_t> &b,
+                                            bool parallel = false) {
+  if (a.empty() || b.empty()) return {};
+
+  size_t real_size = a.size() + b.size() - 1;
+  size_t size = 1;
+  while (size < real_size) size <<= 1;
+
+  std::vector<uint32_t> r1, r2, r3;
+  run_primes(parallel, [&] { r1 = multiply_mod<P1, 31>(a, b, size); },
+             [&] { r2 = multiply_mod<P2, 3>(a, b, size); },
+             [&] { r3 = multiply_mod<P3, 11>(a, b, size); });
+
+  std::vector<uint128_t> product(real_size);
+  for (size_t i = 0; i < real_size; i++)
+    product[i] = crt(r1[i], r2[i], r3[i]);
+  return product;
+}
+
+// forward transforms of a polynomial modulo every prime, padded to the
+// same size, for a polynomial that is multiplied by many others
+struct Transformed {
+  std::vector<uint32_t> r1, r2, r3;
+
+  size_t size() const { return r1.size(); }
+};
+
+inline Transformed transform(const std::vector<uint32_t> &a, size_t size,
+                             bool parallel = false) {
+  Transformed res;
+  run_primes(
+      parallel,
+      [&] {
+        res.r1 = forward_mod<P1>(a, size, roots_table<P1, 31>(size, false));
+      },
+      [&] {
+        res.r2 = forward_mod<P2>(a, size, roots_table<P2, 3>(size, false));
+      },
+      [&] {
+        res.r3 = forward_mod<P3>(a, size, roots_table<P3, 11>(size, false));
+      });
+  return res;
+}
+
+// exact product of a and the transformed polynomial b with real_size
+// coefficients, which must not exceed the size of the transforms
+inline std::vector<uint128_t> multiply_poly(const std::vector<uint32_t> &a,
+                                            const Transformed &b,
+                                            size_t real_size,
+                                            bool parallel = false) {
+  std::vector<uint32_t> r1, r2, r3;
+  run_primes(parallel,
+             [&] { r1 = multiply_transformed_mod<P1, 31>(a, b.r1); },
+             [&] { r2 = multiply_transformed_mod<P2, 3>(a, b.r2); },
+             [&] { r3 = multiply_transformed_mod<P3, 11>(a, b.r3); });
+
+  std::vector<uint128_t> product(real_size);
+  for (size_t i = 0; i < real_size; i++)
+    product[i] = crt(r1[i], r2[i], r3[i]);
+  return product;
+}
+
+// exact square of a polynomial with coefficients below 2^32,
+// 2n - 1 must not exceed MAX_SIZE
+inline std::vector<uint128_t> square_poly(const std::vector<uint32_t> &a,
+                                          bool parallel = false) {
+  if (a.empty()) return {};
+
+  size_t real_size = 2 * a.size() - 1;
+  size_t size = 1;
+  while (size < real_size) size <<= 1;
+
+  std::vector<uint32_t> r1, r2, r3;
+  run_primes(parallel, [&] { r1 = square_mod<P1, 31>(a, size); },
+             [&] { r2 = square_mod<P2, 3>(a, size); },
+             [&] { r3 = square_mod<P3, 11>(a, size); });
+
+  std::vector<uint128_t> product(real_size);
+  for (size_t i = 0; i < real_size; i++)
+    product[i] = crt(r1[i], r2[i], r3[i]);
+  return product;
+}
+
+}  // namespace NTT
@@ -0,0 +1,166 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+// the tasks of one call of run that are not finished yet, parent is the
+// batch of the task that made the call
+struct Batch {
+  size_t remaining;
+  std::exception_ptr error;
+  const Batch* parent;
+};
+
+struct Task {
+  const std::function<void()>* function;
+  Batch* batch;
+};
+
+// the batch of the task that runs on this thread
+thread_local const Batch* current_batch = nullptr;
+
+bool is_nested_in(const Batch* batch, const Batch* ancestor) {
+  for (; batch; batch = batch->parent) {
+    if (batch == ancestor) {
+      return true;
+    }
+  }
+  return false;
+}
+
+class Pool {
+ public:
+  explicit Pool(size_t workers) {
+    for (size_t i = 0; i < workers; ++i) {
+      threads.emplace_back([this] { work(); });
+    }
+  }
+
+  Pool(const Pool&) = delete;
+  Pool& operator=(const Pool&) = delete;
+
+  ~Pool() {
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  // the first task runs on the calling thread, the others are queued. The
+  // waiting thread runs only the tasks of this batch and of the batches
+  // nested in it, as the caller may be in the middle of anything else, like
+  // a product in a per-thread buffer
+  void run(std::initializer_list<std::function<void()>> tasks) {
+    Batch batch{tasks.size(), nullptr, current_batch};
+    {
+      std::lock_guard lock(mutex);
+      for (auto task = tasks.begin() + 1; task != tasks.end(); ++task) {
+        queue.push_back({task, &batch});
+      }
+    }
+    wake.notify_all();
+    done.notify_all();
+    execute({tasks.begin(), &batch});
+    std::unique_lock lock(mutex);
+    while (batch.remaining != 0) {
+      auto found = std::find_if(queue.begin(), queue.end(), [&](Task task) {
+        return is_nested_in(task.batch, &batch);
+      });
+      if (found == queue.end()) {
+        done.wait(lock);
+        continue;
+      }
+      Task task = *found;
+      queue.erase(found);
+      lock.unlock();
+      execute(task);
+      lock.lock();
+    }
+    if (batch.error) {
+      std::rethrow_exception(batch.error);
+    }
+  }
+
+ private:
+  void execute(Task task) {
+    std::exception_ptr error;
+    const Batch* outer = current_batch;
+    current_batch = task.batch;
+    try {
+      (*task.function)();
+    } catch (...) {
+      error = std::current_exception();
+    }
+    current_batch = outer;
+    std::lock_guard lock(mutex);
+    if (error && !task.batch->error) {
+      task.batch->error = error;
+    }
+    if (--task.batch->remaining == 0) {
+      done.notify_all();
+    }
+  }
+
+  void work() {
+    std::unique_lock lock(mutex);
+    while (true) {
+      wake.wait(lock, [this] { return stopping || !queue.empty(); });
+      if (queue.empty()) {
+        return;
+      }
+      Task task = queue.front();
+      queue.pop_front();
+      lock.unlock();
+      execute(task);
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex;
+  // workers wait for tasks, callers of run for the end of their tasks or
+  // for the tasks nested in them
+  std::condition_variable wake;
+  std::condition_variable done;
+  std::deque<Task> queue;
+  bool stopping = false;
+  std::vector<std::thread> threads;
+};
+
+size_t threads_count = 1;
+std::unique_ptr<Pool> pool;
+}  // namespace
+
+void Parallel::set_threads(size_t count) {
+  if (count == 0) {
+    count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  pool.reset();
+  if (count > 1) {
+    pool = std::make_unique<Pool>(count - 1);
+  }
+  threads_count = count;
+}
+
+size_t Parallel::get_threads() { return threads_count; }
+
+void Parallel::run(std::initializer_list<std::function<void()>> tasks,
+                   bool parallel) {
+  if (!parallel || !pool || tasks.size() < 2) {
+    for (const auto& task : tasks) {
+      task();
+    }
+    return;
+  }
+  pool->run(tasks);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+
+/*
+ * Pool of worker threads shared by the multiplications of huge numbers.
+ * It has get_threads() - 1 workers, the thread that runs the tasks is the
+ * last one. The default is a single thread, so nothing runs in parallel
+ * until set_threads is called.
+ */
+namespace Parallel {
+// 0 for the number of hardware threads; must not be called while tasks
+// are running
+void set_threads(size_t count);
+size_t get_threads();
+
+// runs the tasks and returns when all of them are done, in parallel if
+// parallel is set and there are workers, one by one on the calling thread
+// otherwise. Tasks may run tasks themselves: a thread that waits for its
+// tasks runs the queued ones of them and of the tasks nested in them
+// meanwhile, never unrelated ones. An exception thrown by a task is
+// rethrown to the caller, in parallel after the other tasks are finished.
+void run(std::initializer_list<std::function<void()>> tasks,
+         bool parallel = true);
+}  // namespace Parallel
@@ -11,7 +11,7 @@ ModuledBigInt GetRandomNumber() {
 
     //do {
         for (size_t i = 0; i < 100; i++) {
-            ans = (ans + (md * BigInteger(rnd())));
+            ans.addmul(md, BigInteger(rnd()));
             md *= BigInteger(10);
         }
     //} while ((ans.value % P == 0) || (ans.value % Q == 0));
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+
+// the resource SmallVectors created on this thread allocate from,
+// nullptr for the heap
+inline std::pmr::memory_resource*& current_memory_resource() {
+  thread_local std::pmr::memory_resource* resource = nullptr;
+  return resource;
+}
+
+// constants built at compile time can only use the heap
+constexpr std::pmr::memory_resource* creation_resource() {
+  if (std::is_constant_evaluated()) {
+    return nullptr;
+  }
+  return current_memory_resource();
+}
+
+// the heap is always nullptr, so that buffers from new are never freed
+// through the resource and the other way round
+inline std::pmr::memory_resource* normalized_resource(
+    std::pmr::memory_resource* resource) {
+  return resource == std::pmr::new_delete_resource() ? nullptr : resource;
+}
+
+/*
+ * Vector of trivially copyable values that keeps up to InlineCapacity
+ * elements inside the object itself and goes to the heap only when it grows
+ * larger than that. The heap memory comes from the memory resource given at
+ * the construction or the current one of the thread, nullptr stands for new
+ * and delete. As with std::pmr containers, a copy takes the current
+ * resource, a moved vector keeps its own, and assignments keep the resource
+ * of the target. Vectors that fit into the inline storage can be constants.
+ */
+template <typename T, size_t InlineCapacity>
+class SmallVector {
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(InlineCapacity > 0);
+
+ public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  constexpr SmallVector() {
+    // a constant must not have uninitialized parts
+    if (std::is_constant_evaluated()) {
+      std::fill_n(inline_data, InlineCapacity, T());
+    }
+  }
+
+  explicit SmallVector(std::pmr::memory_resource* resource)
+      : resource_(normalized_resource(resource)) {}
+
+  explicit constexpr SmallVector(size_t count, const T& value = T())
+      : SmallVector() {
+    resize(count, value);
+  }
+
+  constexpr SmallVector(std::initializer_list<T> values)
+      : SmallVector(values.begin(), values.end()) {}
+
+  template <typename It>
+  constexpr SmallVector(It first, It last) : SmallVector() {
+    reserve(std::distance(first, last));
+    size_ = std::copy(first, last, data()) - data();
+  }
+
+  constexpr SmallVector(const SmallVector& other)
+      : SmallVector(other.begin(), other.end()) {}
+
+  SmallVector(const SmallVector& other, std::pmr::memory_resource* resource)
+      : resource_(normalized_resource(resource)) {
+    *this = other;
+  }
+
+  constexpr SmallVector(SmallVector&& other) : SmallVector() {
+    resource_ = other.resource_;
+    steal(other);
+  }
+
+  constexpr SmallVector& operator=(const SmallVector& other) {
+    if (this != &other) {
+      size_ = 0;
+      reserve(other.size_);
+      size_ = std::copy(other.begin(), other.end(), data()) - data();
+    }
+    return *this;
+  }
+
+  // the buffer of other is taken only if it comes from the same resource
+  constexpr SmallVector& operator=(SmallVector&& other) {
+    if (!other.is_inline() && !same_resource(other)) {
+      return *this = other;
+    }
+    if (this != &other) {
+      release();
+      steal(other);
+    }
+    return *this;
+  }
+
+  constexpr ~SmallVector() { release(); }
+
+  constexpr size_t size() const { return size_; }
+  constexpr size_t capacity() const { return capacity_; }
+  constexpr bool empty() const { return size_ == 0; }
+  // true if the elements are stored without heap allocation
+  constexpr bool is_inline() const { return heap == nullptr; }
+  std::pmr::memory_resource* resource() const {
+    return resource_ ? resource_ : std::pmr::new_delete_resource();
+  }
+  // true if the buffers of both can be exchanged
+  constexpr bool same_resource(const SmallVector& other) const {
+    return resource_ == other.resource_;
+  }
+
+  constexpr T* data() { return is_inline() ? inline_data : heap; }
+  constexpr const T* data() const {
+    return is_inline() ? inline_data : heap;
+  }
+
+  constexpr iterator begin() { return data(); }
+  constexpr iterator end() { return data() + size_; }
+  constexpr const_iterator begin() const { return data(); }
+  constexpr const_iterator end() const { return data() + size_; }
+
+  constexpr T& operator[](size_t index) { return data()[index]; }
+  constexpr const T& operator[](size_t index) const {
+    return data()[index];
+  }
+
+  constexpr T& front() { return data()[0]; }
+  constexpr const T& front() const { return data()[0]; }
+  constexpr T& back() { return data()[size_ - 1]; }
+  constexpr const T& back() const { return data()[size_ - 1]; }
+
+  constexpr void reserve(size_t new_capacity) {
+    if (new_capacity <= capacity_) {
+      return;
+    }
+    new_capacity = std::max(new_capacity, capacity_ * 2);
+    T* new_heap = resource_ ? static_cast<T*>(resource_->allocate(
+                                  new_capacity * sizeof(T), alignof(T)))
+                            : new T[new_capacity];
+    std::copy(begin(), end(), new_heap);
+    release();
+    heap = new_heap;
+    capacity_ = new_capacity;
+  }
+
+  constexpr void resize(size_t new_size, const T& value = T()) {
+    reserve(new_size);
+    if (new_size > size_) {
+      std::fill(data() + size_, data() + new_size, value);
+    }
+    size_ = new_size;
+  }
+
+  template <typename... Args>
+  constexpr T& emplace_back(Args&&... args) {
+    reserve(size_ + 1);
+    data()[size_] = T(std::forward<Args>(args)...);
+    return data()[size_++];
+  }
+
+  constexpr void push_back(const T& value) { emplace_back(value); }
+
+  constexpr void pop_back() { --size_; }
+
+  // keeps the capacity, so the buffer can be reused
+  constexpr void clear() { size_ = 0; }
+
+  friend constexpr bool operator==(const SmallVector& left,
+                                   const SmallVector& right) {
+    return std::equal(left.begin(), left.end(), right.begin(), right.end());
+  }
+
+ private:
+  // out of line, so that the destructor, which is inlined everywhere,
+  // stays as short as without resources
+  __attribute__((noinline)) void deallocate() {
+    resource_->deallocate(heap, capacity_ * sizeof(T), alignof(T));
+  }
+
+  constexpr void release() {
+    if (resource_) {
+      if (heap) {
+        deallocate();
+      }
+    } else {
+      delete[] heap;
+    }
+    heap = nullptr;
+    capacity_ = InlineCapacity;
+  }
+
+  // expects this to be released
+  constexpr void steal(SmallVector& other) {
+    if (other.is_inline()) {
+      std::copy(other.begin(), other.end(), inline_data);
+    } else {
+      heap = other.heap;
+      capacity_ = other.capacity_;
+      other.heap = nullptr;
+      other.capacity_ = InlineCapacity;
+    }
+    size_ = other.size_;
+    other.size_ = 0;
+  }
+
+  std::pmr::memory_resource* resource_ = creation_resource();
+  T* heap = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = InlineCapacity;
+  T inline_data[InlineCapacity];
+};
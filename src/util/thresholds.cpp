@@ -0,0 +1,305 @@
+#include "thresholds.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bigint.hpp"
+#include "multiply.hpp"
+#include "parallel.hpp"
+
+namespace {
+struct Field {
+  const char* name;
+  size_t Thresholds::*value;
+  // smaller values make the algorithm split an operand into parts which
+  // are not shorter, and it never returns
+  size_t minimum;
+};
+
+const Field FIELDS[] = {
+    {"karatsuba", &Thresholds::karatsuba, 4},
+    {"toom3", &Thresholds::toom3, 4},
+    {"ntt", &Thresholds::ntt, 1},
+    {"fft", &Thresholds::fft, 1},
+    {"karatsuba_square", &Thresholds::karatsuba_square, 4},
+    {"toom3_square", &Thresholds::toom3_square, 4},
+    {"ntt_square", &Thresholds::ntt_square, 1},
+    {"fft_square", &Thresholds::fft_square, 1},
+    {"parallel", &Thresholds::parallel, 1},
+    {"recursive_division", &Thresholds::recursive_division, 1},
+    {"barrett_division", &Thresholds::barrett_division, 1},
+    {"newton_division", &Thresholds::newton_division, 1},
+    {"newton_reciprocal", &Thresholds::newton_reciprocal, 2},
+};
+
+void check_minimum(const Field& field, size_t value) {
+  if (value < field.minimum) {
+    throw std::invalid_argument("Threshold " + std::string(field.name) +
+                                " must be at least " +
+                                std::to_string(field.minimum));
+  }
+}
+
+const size_t NEVER = std::numeric_limits<size_t>::max();
+
+// seconds per call, the best of a few runs of at least 10 ms each
+double time_per_call(const std::function<void()>& operation) {
+  using Clock = std::chrono::steady_clock;
+  double best = std::numeric_limits<double>::infinity();
+  for (int run = 0; run < 3; ++run) {
+    size_t calls = 0;
+    auto start = Clock::now();
+    std::chrono::duration<double> elapsed{};
+    do {
+      operation();
+      ++calls;
+      elapsed = Clock::now() - start;
+    } while (elapsed.count() < 0.01);
+    best = std::min(best, elapsed.count() / double(calls));
+  }
+  return best;
+}
+
+std::vector<uint64_t> random_limbs(size_t size) {
+  static std::mt19937_64 random(179);
+  std::vector<uint64_t> limbs(size);
+  for (auto& limb : limbs) {
+    limb = random();
+  }
+  // the operands are exactly that long
+  limbs.back() |= uint64_t(1) << 63;
+  return limbs;
+}
+
+double multiply_time(size_t size) {
+  auto a = random_limbs(size);
+  auto b = random_limbs(size);
+  std::vector<uint64_t> res(2 * size);
+  std::vector<uint64_t> scratch(Multiply::multiply_scratch_size(size, size));
+  return time_per_call([&] {
+    Multiply::multiply(a.data(), size, b.data(), size, res.data(),
+                       scratch.data());
+  });
+}
+
+double square_time(size_t size) {
+  auto a = random_limbs(size);
+  std::vector<uint64_t> res(2 * size);
+  std::vector<uint64_t> scratch(Multiply::square_scratch_size(size));
+  return time_per_call([&] {
+    Multiply::square(a.data(), size, res.data(), scratch.data());
+  });
+}
+
+// a dividend twice as long as the divisor, as a product reduced by a modulus
+double division_time(size_t size) {
+  auto dividend = BigInteger::from_limbs(random_limbs(2 * size));
+  auto divisor = BigInteger::from_limbs(random_limbs(size));
+  return time_per_call([&] { BigInteger::divide(dividend, divisor); });
+}
+
+double reciprocal_division_time(size_t size) {
+  auto dividend = BigInteger::from_limbs(random_limbs(2 * size));
+  BigInteger::Reciprocal reciprocal(BigInteger::from_limbs(random_limbs(size)));
+  return time_per_call([&] { BigInteger::divide(dividend, reciprocal); });
+}
+
+double reciprocal_time(size_t size) {
+  auto divisor = BigInteger::from_limbs(random_limbs(size));
+  return time_per_call([&] { BigInteger::Reciprocal reciprocal(divisor); });
+}
+
+struct Tier {
+  size_t Thresholds::*threshold;
+  size_t low;
+  size_t high;
+  double (*time)(size_t);
+  Multiply::Engine engine;
+  // the other thresholds while this one is measured
+  void (*prepare)(Thresholds&);
+};
+
+void nothing(Thresholds&) {}
+void without_reciprocals(Thresholds& thresholds) {
+  thresholds.newton_division = NEVER;
+}
+void with_reciprocals(Thresholds& thresholds) {
+  thresholds.barrett_division = 1;
+}
+
+// every tier is measured with the ones below it already tuned
+const Tier TIERS[] = {
+    {&Thresholds::karatsuba, 8, 256, multiply_time, Multiply::Engine::kNTT,
+     nothing},
+    {&Thresholds::toom3, 64, 2048, multiply_time, Multiply::Engine::kNTT,
+     nothing},
+    {&Thresholds::karatsuba_square, 16, 512, square_time,
+     Multiply::Engine::kNTT, nothing},
+    {&Thresholds::toom3_square, 64, 2048, square_time, Multiply::Engine::kNTT,
+     nothing},
+    {&Thresholds::ntt, 1024, 32768, multiply_time, Multiply::Engine::kNTT,
+     nothing},
+    {&Thresholds::ntt_square, 1024, 32768, square_time,
+     Multiply::Engine::kNTT, nothing},
+    {&Thresholds::fft, 1024, 32768, multiply_time, Multiply::Engine::kFFT,
+     nothing},
+    {&Thresholds::fft_square, 1024, 32768, square_time,
+     Multiply::Engine::kFFT, nothing},
+    {&Thresholds::parallel, 128, 8192, multiply_time, Multiply::Engine::kNTT,
+     nothing},
+    {&Thresholds::barrett_division, 4, 512, reciprocal_division_time,
+     Multiply::Engine::kNTT, nothing},
+    {&Thresholds::newton_reciprocal, 8, 1024, reciprocal_time,
+     Multiply::Engine::kNTT, with_reciprocals},
+    {&Thresholds::recursive_division, 64, 8192, division_time,
+     Multiply::Engine::kNTT, without_reciprocals},
+    {&Thresholds::newton_division, 256, 16384, division_time,
+     Multiply::Engine::kNTT, nothing},
+};
+
+const char* field_name(size_t Thresholds::*value) {
+  for (const Field& field : FIELDS) {
+    if (field.value == value) {
+      return field.name;
+    }
+  }
+  return "";
+}
+
+// the profile of BIGINT_THRESHOLDS replaces the defaults before main
+const bool profile_loaded = [] {
+  const char* path = std::getenv("BIGINT_THRESHOLDS");
+  if (path == nullptr) {
+    return false;
+  }
+  try {
+    Thresholds::set(Thresholds::load(path));
+  } catch (const std::exception&) {
+    return false;
+  }
+  return true;
+}();
+}  // namespace
+
+// constant initialization, so the defaults are in place for any dynamic
+// initializer that runs before the profile is loaded
+constinit Thresholds Thresholds::active{};
+
+void Thresholds::set(const Thresholds& thresholds) {
+  for (const Field& field : FIELDS) {
+    check_minimum(field, thresholds.*field.value);
+  }
+  active = thresholds;
+}
+
+Thresholds Thresholds::parse(std::istream& in) {
+  Thresholds thresholds;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream words(line);
+    std::string name;
+    if (!(words >> name) || name[0] == '#') {
+      continue;
+    }
+    auto field = std::find_if(
+        std::begin(FIELDS), std::end(FIELDS),
+        [&name](const Field& field) { return name == field.name; });
+    if (field == std::end(FIELDS)) {
+      throw std::invalid_argument("Unknown threshold " + name);
+    }
+    std::string value;
+    std::string rest;
+    if (!(words >> value) || words >> rest || value.empty() ||
+        !std::all_of(value.begin(), value.end(),
+                     [](char c) { return '0' <= c && c <= '9'; })) {
+      throw std::invalid_argument("Malformed threshold line: " + line);
+    }
+    try {
+      thresholds.*field->value = std::stoull(value);
+    } catch (const std::out_of_range&) {
+      throw std::invalid_argument("Threshold " + name + " is too large");
+    }
+    check_minimum(*field, thresholds.*field->value);
+  }
+  return thresholds;
+}
+
+void Thresholds::write(std::ostream& out) const {
+  for (const Field& field : FIELDS) {
+    out << field.name << ' ' << this->*field.value << '\n';
+  }
+}
+
+Thresholds Thresholds::load(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("Can't read thresholds from " + path);
+  }
+  return parse(in);
+}
+
+size_t Thresholds::find_crossover(
+    size_t low, size_t high,
+    const std::function<double(size_t, bool)>& cost) {
+  std::vector<size_t> sizes;
+  for (size_t size = low; size < high;
+       size = std::max(size + 1, size * 5 / 4)) {
+    sizes.push_back(size);
+  }
+  sizes.push_back(high);
+  bool previous_faster = false;
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    bool faster = cost(sizes[i], true) < cost(sizes[i], false);
+    if (faster && (previous_faster || i + 1 == sizes.size())) {
+      return sizes[i - (i > 0 && previous_faster)];
+    }
+    previous_faster = faster;
+  }
+  return high;
+}
+
+Thresholds Thresholds::calibrate(std::ostream* log) {
+  // the state of the process is restored even if a measurement throws
+  struct Restore {
+    Thresholds thresholds = current();
+    Multiply::Engine engine = Multiply::get_large_engine();
+    ~Restore() {
+      set(thresholds);
+      Multiply::set_large_engine(engine);
+    }
+  } restore;
+  Thresholds tuned;
+  for (const Tier& tier : TIERS) {
+    const char* name = field_name(tier.threshold);
+    if (tier.threshold == &Thresholds::parallel &&
+        Parallel::get_threads() == 1) {
+      if (log) {
+        *log << name << ": a single thread, kept " << tuned.parallel << '\n';
+      }
+      continue;
+    }
+    Multiply::set_large_engine(tier.engine);
+    tuned.*tier.threshold = find_crossover(
+        tier.low, tier.high, [&tier, &tuned](size_t size, bool upper) {
+          Thresholds probe = tuned;
+          tier.prepare(probe);
+          probe.*tier.threshold = upper ? size : size + 1;
+          set(probe);
+          return tier.time(size);
+        });
+    if (log) {
+      *log << name << ": " << tuned.*tier.threshold << std::endl;
+    }
+  }
+  return tuned;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <string>
+
+/*
+ * Sizes in limbs from which the arithmetic switches to the next algorithm.
+ * The compiled defaults were measured with -O2 on x86-64; calibrate()
+ * measures them on the current machine, and ZK_auth_tune writes them to a
+ * profile. The profile named by the BIGINT_THRESHOLDS environment variable
+ * is loaded at startup; without one, or if it can't be read, the defaults
+ * stay.
+ *
+ * A profile has a "name value" line per threshold, lines starting with #
+ * are comments, and the thresholds it does not name keep their defaults.
+ */
+struct Thresholds {
+  // multiplication, in limbs of the shorter operand
+  size_t karatsuba = 32;
+  size_t toom3 = 192;
+  size_t ntt = 7168;
+  size_t fft = 16384;
+  size_t karatsuba_square = 80;
+  size_t toom3_square = 256;
+  size_t ntt_square = 7168;
+  size_t fft_square = 16384;
+  // products split their work between the threads of Parallel from there
+  size_t parallel = 1024;
+  // division, in limbs of the divisor: the recursive division instead of
+  // the long one, the Barrett division with a Reciprocal, a single division
+  // through a Reciprocal, and the reciprocal itself by Newton iteration
+  size_t recursive_division = 1024;
+  size_t barrett_division = 64;
+  size_t newton_division = 3072;
+  size_t newton_reciprocal = 64;
+
+  bool operator==(const Thresholds&) const = default;
+
+  // the thresholds in use, read by every product and division
+  static const Thresholds& current() { return active; }
+  // must not be called while other threads multiply or divide; throws
+  // std::invalid_argument for a threshold too small for its algorithm to
+  // terminate: 4 for the Karatsuba and Toom-3 ones, 2 for newton_reciprocal
+  // and 1 for the rest
+  static void set(const Thresholds&);
+
+  // throws std::invalid_argument for unknown names, values that are not
+  // numbers or are too small as in set(), and malformed lines
+  static Thresholds parse(std::istream&);
+  void write(std::ostream&) const;
+  // throws std::runtime_error if the file can't be read
+  static Thresholds load(const std::string& path);
+
+  // Measures every threshold on this machine, from the smallest algorithms
+  // up, each with the ones below it already measured; takes some seconds.
+  // Leaves current() as it was. Progress goes to log if it is given.
+  static Thresholds calibrate(std::ostream* log = nullptr);
+  // The first size of the geometric grid from low to high where the upper
+  // algorithm is faster both there and at the next size, which filters out
+  // single noisy measurements; low if it is faster from the start and high
+  // if it never is. cost(size, upper) is the time of an operation of that
+  // size by the lower or the upper algorithm.
+  static size_t find_crossover(size_t low, size_t high,
+                               const std::function<double(size_t, bool)>& cost);
+
+ private:
+  static Thresholds active;
+};
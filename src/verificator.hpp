@@ -9,10 +9,10 @@ public:
 
     void Init(Message message) {
         k = message.arr.size();
-        public_key.resize(k);
+        public_key.clear();
         last_query.resize(k);
         for (size_t i = 0; i < k; i++) {
-            public_key[i] = message.arr[i];
+            public_key.emplace_back(message.arr[i]);
         }
         std::cout << "V: Public key received\n";
     }
@@ -24,17 +24,22 @@ public:
             regenerate();
             return {iter + 1, last_query, Respond::kContinue};
         } else {
-            ModuledBigInt Y = message.arr[0];
-            ModuledBigInt accum = Y * Y;
-            std::cout << "V: Checking that X is equal to " << Y.get_value() << " * " << Y.get_value();
-            for (size_t i = 0; i < k; i++) {
-                if (last_query[i].get_value()) {
-                    accum *= public_key[i];
-                    std::cout << " * " << public_key[i].get_value();
+            bool good;
+            {
+                // the temporaries of the check are freed at once
+                BigInteger::Round round;
+                ModuledBigInt Y = message.arr[0];
+                ModuledBigInt accum = Y.square();
+                std::cout << "V: Checking that X is equal to " << Y.get_value() << " * " << Y.get_value();
+                for (size_t i = 0; i < k; i++) {
+                    if (last_query[i].get_value()) {
+                        accum *= public_key[i];
+                        std::cout << " * " << public_key[i].get_value();
+                    }
                 }
+                std::cout << " = " << accum.get_value() << std::endl;
+                good = (X == accum) || (X == -accum);
             }
-            std::cout << " = " << accum.get_value() << std::endl;
-            bool good = (X == accum) || (X == -accum);
             if (!good) {
                 return {iter + 1, {}, Respond::kFailed};
             } else {
@@ -67,5 +72,6 @@ private:
     ModuledBigInt X{0};
     std::mt19937 rnd{123};
     std::vector<ModuledBigInt> last_query;
-    std::vector<ModuledBigInt> public_key;
+    // every round multiplies by the same keys
+    std::vector<ModuledBigInt::Prepared> public_key;
 };
\ No newline at end of file
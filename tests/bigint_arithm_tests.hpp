@@ -42,6 +42,165 @@ TEST(BigIntOperatorTests, DivMultRandom) {
     }
 }
 
+TEST(BigIntOperatorTests, DivMultUnnormalized) {
+    // divisors with a small most significant limb
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+        BigInteger first = random_bigint(200);
+        BigInteger second = random_bigint(40) + BigInteger("18446744073709551616");
+        auto [quot, rem] = BigInteger::divide(first, second);
+        ASSERT_TRUE(BigInteger(0) <= rem);
+        ASSERT_TRUE(rem < second);
+        ASSERT_EQ(first, quot * second + rem);
+    }
+}
+
+TEST(BigIntOperatorTests, DivLongCorrections) {
+    // digits of the quotient are overestimated for such divisors,
+    // so the long division has to correct them
+    BigInteger limb_base("18446744073709551616");
+    BigInteger half = limb_base / 2;
+    for (int limbs = 2; limbs < 10; ++limbs) {
+        BigInteger second = half;
+        for (int i = 1; i < limbs; ++i) {
+            second = second * limb_base + (i % 2 ? 0 : limb_base - 1);
+        }
+        for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+            BigInteger quot = random_bigint(20 * limbs) * limb_base - 1;
+            for (BigInteger rem : {BigInteger(0), BigInteger(1), second - 1}) {
+                ASSERT_EQ(std::make_pair(quot, rem),
+                          BigInteger::divide(quot * second + rem, second));
+            }
+        }
+    }
+}
+
+TEST(BigIntOperatorTests, DivSingleLimb) {
+    BigInteger limb = BigInteger("18446744073709551615");
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+        BigInteger first = random_bigint(300);
+        for (BigInteger second : {BigInteger(7), -limb, limb - random_value()}) {
+            auto [quot, rem] = BigInteger::divide(first, second);
+            ASSERT_TRUE(abs(rem) < abs(second));
+            ASSERT_EQ(first, quot * second + rem);
+            ASSERT_EQ(rem, (-first) % second * -1);
+        }
+    }
+}
+
+TEST(BigIntOperatorTests, DivReciprocal) {
+    // the largest divisors are long enough for the Newton iteration
+    for (size_t digits : {1, 20, 100, 1500, 4000}) {
+        for (int i = 0; i < 4; ++i) {
+            BigInteger first = random_bigint(digits * (1 + i));
+            BigInteger second = random_bigint(digits);
+            if (i & 1) first = -first;
+            if (i & 2) second = -second;
+            BigInteger::Reciprocal reciprocal(second);
+            ASSERT_EQ(BigInteger::divide(first, second),
+                      BigInteger::divide(first, reciprocal));
+            ASSERT_EQ(BigInteger::divide(second, second),
+                      BigInteger::divide(second, reciprocal));
+        }
+    }
+}
+
+TEST(BigIntOperatorTests, DivReciprocalPowersOfTwo) {
+    // reciprocals of these divisors are exact powers of two or just below
+    BigInteger first = random_bigint(6000);
+    BigInteger power = 1;
+    for (int i = 0; i < 64 * 150; ++i) {
+        power *= 2;
+    }
+    for (BigInteger second : {power, power - 1, power + 1, power * 3}) {
+        auto [quot, rem] = BigInteger::divide(first, BigInteger::Reciprocal(second));
+        ASSERT_TRUE(BigInteger(0) <= rem);
+        ASSERT_TRUE(rem < second);
+        ASSERT_EQ(first, quot * second + rem);
+    }
+}
+
+TEST(BigIntOperatorTests, DivNewton) {
+    BigInteger first = random_bigint(150000);
+    BigInteger second = random_bigint(65000);
+    auto [quot, rem] = BigInteger::divide(first, second);
+    ASSERT_TRUE(BigInteger(0) <= rem);
+    ASSERT_TRUE(rem < second);
+    ASSERT_EQ(first, quot * second + rem);
+}
+
+TEST(BigIntOperatorTests, DivReciprocalTransformed) {
+    // the divisor is long enough for the reciprocal to keep transforms
+    BigInteger second = random_bigint(140000);
+    BigInteger::Reciprocal reciprocal(second);
+    for (size_t digits : {140000, 200000, 420000}) {
+        BigInteger first = random_bigint(digits);
+        auto [quot, rem] = BigInteger::divide(first, reciprocal);
+        ASSERT_TRUE(BigInteger(0) <= rem);
+        ASSERT_TRUE(rem < second);
+        ASSERT_EQ(first, quot * second + rem);
+    }
+}
+
+TEST(BigIntOperatorTests, MulPrepared) {
+    for (size_t digits : {1, 20, 100, 140000}) {
+        BigInteger first = random_bigint(digits);
+        BigInteger second = random_bigint(digits);
+        for (int i = 0; i < 4; ++i) {
+            BigInteger a = i & 1 ? -first : first;
+            BigInteger b = i & 2 ? -second : second;
+            BigInteger::Prepared prepared(b);
+            ASSERT_EQ(prepared.value(), b);
+            BigInteger expected = a * b;
+            ASSERT_EQ(a * prepared, expected);
+            ASSERT_EQ(BigInteger(a) * prepared, expected);
+            BigInteger c = a;
+            c *= prepared;
+            ASSERT_EQ(c, expected);
+            // longer than the prepared number
+            ASSERT_EQ(expected * prepared, expected * b);
+        }
+    }
+    ASSERT_EQ(BigInteger(0) * BigInteger::Prepared(BigInteger(5)), 0);
+    ASSERT_EQ(BigInteger(5) * BigInteger::Prepared(BigInteger(0)), 0);
+}
+
+TEST(BigIntOperatorTests, DivReciprocalByZero) {
+    ASSERT_THROW(BigInteger::Reciprocal(BigInteger(0)), std::logic_error);
+}
+
+BigInteger euclid_gcd(BigInteger a, BigInteger b) {
+    a = abs(a);
+    b = abs(b);
+    while (b) {
+        a %= b;
+        swap(a, b);
+    }
+    return a;
+}
+
+TEST(BigIntMethodsTests, GcdExtended) {
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+        for (size_t digits : {5, 30, 100, 1000}) {
+            BigInteger common = random_bigint(1 + i % 25) + 1;
+            BigInteger a = random_bigint(digits) * (i % 2 ? common : 1);
+            BigInteger b = random_bigint(digits + i % 3 * 10) * (i % 3 ? common : 1);
+            if (i & 4) a = -a;
+            if (i & 8) b = -b;
+            auto [gcd, x] = BigInteger::gcd_extended(a, b);
+            ASSERT_EQ(euclid_gcd(a, b), gcd);
+            ASSERT_EQ(0, (a * x - gcd) % b);
+        }
+    }
+}
+
+TEST(BigIntMethodsTests, GcdExtendedZero) {
+    BigInteger a = random_bigint(100);
+    ASSERT_EQ(a, BigInteger::gcd_extended(a, 0).first);
+    ASSERT_EQ(a, BigInteger::gcd_extended(0, -a).first);
+    ASSERT_EQ(a, BigInteger::gcd_extended(-a, 0).first);
+    ASSERT_EQ(0, BigInteger::gcd_extended(0, 0).first);
+}
+
 TEST(BigIntOperatorTests, DivMemory) {
     CHECK_OPERATOR_ALLOCATIONS(/, 2);
 }
@@ -106,6 +265,22 @@ TEST(BigIntOperatorTests, PlusEQRandom) {
     }
 }
 
+TEST(BigIntOperatorTests, PlusEQLimbCarry) {
+    BigInteger a("18446744073709551615");
+    a += 1;
+    ASSERT_EQ(BigInteger("18446744073709551616"), a);
+    a += BigInteger("340282366920938463463374607431768211455");
+    ASSERT_EQ(BigInteger("340282366920938463481821351505477763071"), a);
+}
+
+TEST(BigIntOperatorTests, MinusEQLimbBorrow) {
+    BigInteger a("340282366920938463463374607431768211456");
+    a -= 1;
+    ASSERT_EQ(BigInteger("340282366920938463463374607431768211455"), a);
+    a -= BigInteger("340282366920938463463374607431768211456");
+    ASSERT_EQ(-1, a);
+}
+
 TEST(BigIntOperatorTests, PlusEQTime) {
     int total_time = 0;
     int time_treshold = 1000000;
@@ -201,6 +376,70 @@ TEST(BigIntOperatorTests, TimesEQTime) {
     }
 }
 
+TEST(BigIntOperatorTests, Square) {
+    for (size_t digits : {1, 10, 20, 100, 1000, 5000, 20000}) {
+        BigInteger a = random_bigint(digits);
+        BigInteger b = a;
+        ASSERT_EQ(a * b, a.square());
+        ASSERT_EQ(a * b, (-a).square());
+        ASSERT_EQ(a * b, a * a);
+    }
+    ASSERT_EQ(0, BigInteger(0).square());
+}
+
+TEST(BigIntOperatorTests, AddMulRandom) {
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+        for (size_t c_digits : {1, 15, 100}) {
+            BigInteger a = random_bigint(100);
+            BigInteger b = random_bigint(1 + i % 150);
+            BigInteger c = random_bigint(c_digits);
+            if (i & 1) a = -a;
+            if (i & 2) b = -b;
+            if (i & 4) c = -c;
+            BigInteger sum = a;
+            sum.addmul(b, c);
+            ASSERT_EQ(a + b * c, sum);
+            BigInteger difference = a;
+            difference.submul(b, c);
+            ASSERT_EQ(a - b * c, difference);
+            ASSERT_EQ(b * c + a, BigInteger::mul_add(b, c, a));
+        }
+    }
+}
+
+TEST(BigIntOperatorTests, AddMulCornerCases) {
+    BigInteger a = 12;
+    a.submul(a, a);
+    ASSERT_EQ(-132, a);
+    a.addmul(a, BigInteger(2));
+    ASSERT_EQ(-396, a);
+    a.addmul(BigInteger(3), a);
+    ASSERT_EQ(-1584, a);
+    a.addmul(BigInteger(0), a);
+    ASSERT_EQ(-1584, a);
+    a.submul(BigInteger(-66), BigInteger(-24));
+    ASSERT_EQ(-3168, a);
+    a.addmul(BigInteger(-66), BigInteger(-48));
+    ASSERT_EQ(0, a);
+    ASSERT_FALSE(a.is_negative());
+    a.submul(BigInteger(7), BigInteger(8));
+    ASSERT_EQ(-56, a);
+    BigInteger b("18446744073709551615");
+    b.addmul(b, b);
+    ASSERT_EQ(340282366920938463444927863358058659840_bi, b);
+}
+
+TEST(BigIntOperatorTests, AddMulMemory) {
+    BigInteger a("123456789012345678901234567890");
+    BigInteger b("98765432109876543210987654321");
+    BigInteger c(1234567);
+    OperatorNewCounter cntr;
+    a.addmul(b, c);
+    a.submul(b, b);
+    a.addmul(c, b);
+    ASSERT_EQ(cntr.get_counter(), 0);
+}
+
 TEST(BigIntOperatorTests, TimesEqMemory) {
     CHECK_OPERATOR_ALLOCATIONS(*=, 2);
 }
@@ -648,4 +887,102 @@ TEST(BigIntMethodsTests, ShiftTime) {
         ASSERT_LE(total_time, time_treshold);
     }
 }
-*/
\ No newline at end of file
+*/
+TEST(BigIntOperatorTests, RvalueOperators) {
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+        BigInteger a = random_bigint(300);
+        BigInteger b = random_bigint(150);
+        if (i % 2 == 0) {
+            a = -a;
+        }
+        BigInteger sum = a + b;
+        BigInteger difference = a - b;
+        BigInteger product = a * b;
+        auto [quotient, remainder] = BigInteger::divide(a, b);
+        ASSERT_EQ(sum, BigInteger(a) + b);
+        ASSERT_EQ(sum, a + BigInteger(b));
+        ASSERT_EQ(sum, BigInteger(a) + BigInteger(b));
+        ASSERT_EQ(difference, BigInteger(a) - b);
+        ASSERT_EQ(difference, a - BigInteger(b));
+        ASSERT_EQ(difference, BigInteger(a) - BigInteger(b));
+        ASSERT_EQ(product, BigInteger(a) * b);
+        ASSERT_EQ(product, a * BigInteger(b));
+        ASSERT_EQ(product, BigInteger(a) * BigInteger(b));
+        ASSERT_EQ(quotient, BigInteger(a) / b);
+        ASSERT_EQ(remainder, BigInteger(a) % b);
+        ASSERT_EQ(-a, -BigInteger(a));
+        ASSERT_EQ(std::make_pair(quotient, remainder), BigInteger::divide(BigInteger(a), b));
+    }
+    ASSERT_EQ(0, -BigInteger(0));
+    ASSERT_EQ(0, 5 - BigInteger(5));
+}
+
+TEST(BigIntOperatorTests, CompoundSelf) {
+    BigInteger a = random_bigint(200);
+    BigInteger copy = a;
+    a *= a;
+    ASSERT_EQ(copy * copy, a);
+    a %= a;
+    ASSERT_EQ(0, a);
+    a = copy;
+    a /= a;
+    ASSERT_EQ(1, a);
+    a = copy;
+    ASSERT_EQ(std::make_pair(BigInteger(1), BigInteger(0)),
+              BigInteger::divide(std::move(a), a));
+}
+
+TEST(BigIntOperatorTests, RvalueReusesBuffer) {
+    // heap allocated, with a small top limb so that the sum does not grow
+    BigInteger a = random_bigint(300) + 1;
+    BigInteger b = random_bigint(200);
+    {
+        OperatorNewCounter cntr;
+        BigInteger sum = std::move(a) + b;
+        BigInteger difference = b - std::move(sum);
+        a = -std::move(difference);
+        ASSERT_EQ(0, cntr.get_counter());
+    }
+    BigInteger c = random_bigint(300);
+    // the product and the remainder alternate between two buffers
+    for (int i = 0; i < 2; ++i) {
+        a *= c;
+        a %= b;
+    }
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+        {
+            OperatorNewCounter cntr;
+            a *= c;
+            ASSERT_EQ(0, cntr.get_counter());
+        }
+        a %= b;
+    }
+}
+
+TEST(BigIntMethodsTests, Pow) {
+    ASSERT_EQ(BigInteger(1), pow(BigInteger(0), 0));
+    ASSERT_EQ(BigInteger(0), pow(BigInteger(0), 5));
+    ASSERT_EQ(BigInteger(-8), pow(BigInteger(-2), 3));
+    ASSERT_EQ(BigInteger("515377520732011331036461129765621272702107522001"), pow(BigInteger(3), 100));
+    BigInteger a = random_bigint(30);
+    ASSERT_EQ(a * a * a * a * a * a * a, pow(a, 7));
+}
+
+TEST(BigIntMethodsTests, PowMod) {
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+        BigInteger m = random_bigint(i * 40 + 1) + 1;
+        BigInteger::Reciprocal modulus(i % 2 ? m : -m);
+        BigInteger base = i % 3 ? random_bigint(200) : -random_bigint(200);
+        unsigned long long e = random_value() % 50;
+        BigInteger expected = pow(base, e) % m;
+        if (expected.is_negative()) {
+            expected += m;
+        }
+        ASSERT_EQ(expected, BigInteger::pow_mod(base, BigInteger(e), modulus));
+    }
+    // Fermat's little theorem for a prime modulus
+    BigInteger p("170141183460469231731687303715884105727");
+    BigInteger::Reciprocal modulus(p);
+    ASSERT_EQ(BigInteger(1), BigInteger::pow_mod(random_bigint(60), p - 1, modulus));
+    ASSERT_THROW(BigInteger::pow_mod(2, -1, modulus), std::domain_error);
+}
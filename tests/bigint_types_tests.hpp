@@ -137,6 +137,29 @@ TEST(BigIntMethodTests, ToStringZeroesFromString) {
     ASSERT_EQ("179", static_cast<std::string>(a));
 }
 
+TEST(BigIntMethodTests, ToStringFromStringLong) {
+    // long enough to be converted by halves
+    for (size_t digits : {1500, 5000, 30000}) {
+        string s = "-" + static_cast<std::string>(random_bigint(digits) + 1);
+        s += string(digits, '0') + "179" + string(digits / 3, '9');
+        BigInteger a(s);
+
+        ASSERT_EQ(s, static_cast<std::string>(a));
+    }
+}
+
+TEST(BigIntMethodTests, StringPowersOfTen) {
+    BigInteger power = 1;
+    for (size_t digits = 1; digits < 3000; ++digits) {
+        power *= 10;
+        if (digits % 379 == 0 || digits % 1216 == 0) {
+            ASSERT_EQ(power, BigInteger("1" + string(digits, '0')));
+            ASSERT_EQ(string(digits, '9'), static_cast<std::string>(power - 1));
+            ASSERT_EQ("1" + string(digits, '0'), static_cast<std::string>(power));
+        }
+    }
+}
+
 TEST(BigIntOperatorTests, LLCast) {
     BigInteger a = 1791791791;
     long long b = static_cast<long long>(a);
@@ -249,3 +272,173 @@ TEST(BigIntOperatorTests, LiteralZero) {
     auto a = 000000000_bi;
     ASSERT_EQ(0, a);
 }
+
+TEST(BigIntOperatorTests, LiteralConstexpr) {
+    constexpr BigInteger a = 18446744073709551616_bi;
+    constexpr BigInteger b = 1'000'000_bi;
+    static_assert(b == BigInteger(1000000));
+    static_assert(a != b);
+    ASSERT_EQ(BigInteger("18446744073709551616"), a);
+}
+
+TEST(BigIntOperatorTests, LiteralLong) {
+    // longer than the inline limbs, so it is built at run time
+    auto a = 1234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890_bi;
+    ASSERT_EQ(BigInteger("1234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890"), a);
+}
+
+TEST(BigIntBytesTests, KnownValues) {
+    BigInteger a = 0x0102030405060708ll;
+    a = a * 256 + 9;
+    std::vector<uint8_t> big = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    std::vector<uint8_t> little = {9, 8, 7, 6, 5, 4, 3, 2, 1, 0};
+    ASSERT_EQ(9, a.byte_length());
+    ASSERT_EQ(big, a.to_bytes(10));
+    ASSERT_EQ(little, a.to_bytes(10, BigInteger::ByteOrder::kLittleEndian));
+    ASSERT_EQ(a, BigInteger::from_bytes(big));
+    ASSERT_EQ(a, BigInteger::from_bytes(little, BigInteger::ByteOrder::kLittleEndian));
+    ASSERT_EQ(std::vector<uint8_t>(3, 0), BigInteger(0).to_bytes(3));
+    ASSERT_EQ(0, BigInteger::from_bytes({}));
+    ASSERT_EQ(0, BigInteger::from_bytes(std::vector<uint8_t>(20, 0)));
+}
+
+TEST(BigIntBytesTests, RoundTrip) {
+    for (auto order : {BigInteger::ByteOrder::kBigEndian, BigInteger::ByteOrder::kLittleEndian}) {
+        for (size_t digits = 1; digits < 200; digits += 7) {
+            BigInteger a = abs(random_bigint(digits));
+            for (size_t size = a.byte_length(); size < a.byte_length() + 17; ++size) {
+                auto bytes = a.to_bytes(size, order);
+                ASSERT_EQ(size, bytes.size());
+                ASSERT_EQ(a, BigInteger::from_bytes(bytes, order));
+            }
+        }
+    }
+}
+
+TEST(BigIntBytesTests, Span) {
+    BigInteger a = abs(random_bigint(100));
+    std::vector<uint8_t> buffer(100, 0xFF);
+    a.to_bytes(std::span(buffer).subspan(10, 50));
+    ASSERT_EQ(0xFF, buffer[9]);
+    ASSERT_EQ(0xFF, buffer[60]);
+    ASSERT_EQ(a, BigInteger::from_bytes(std::span(buffer).subspan(10, 50)));
+}
+
+TEST(BigIntBytesTests, Errors) {
+    BigInteger a = 65536;
+    ASSERT_THROW(a.to_bytes(2), std::length_error);
+    ASSERT_THROW((-a).to_bytes(3), std::logic_error);
+    std::vector<uint8_t> short_prefix = {0, 0, 0};
+    ASSERT_THROW(BigInteger::from_prefixed_bytes(short_prefix), std::length_error);
+    auto bytes = a.to_prefixed_bytes();
+    bytes.pop_back();
+    ASSERT_THROW(BigInteger::from_prefixed_bytes(bytes), std::length_error);
+    std::vector<uint8_t> small(4);
+    ASSERT_THROW(a.to_prefixed_bytes(small), std::length_error);
+}
+
+TEST(BigIntBytesTests, Prefixed) {
+    std::vector<BigInteger> values = {0, 1, -1, 255, -256};
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+        values.push_back(random_bigint(100));
+    }
+    std::vector<uint8_t> stream;
+    for (const auto& value : values) {
+        auto bytes = value.to_prefixed_bytes();
+        ASSERT_EQ(value.prefixed_size(), bytes.size());
+        stream.insert(stream.end(), bytes.begin(), bytes.end());
+    }
+    std::span<const uint8_t> rest = stream;
+    for (const auto& value : values) {
+        auto [read, size] = BigInteger::from_prefixed_bytes(rest);
+        ASSERT_EQ(value, read);
+        rest = rest.subspan(size);
+    }
+    ASSERT_TRUE(rest.empty());
+    ASSERT_EQ((std::vector<uint8_t>{0, 0, 0, 3, 1}), BigInteger(-1).to_prefixed_bytes());
+}
+
+// counts the allocations and passes them to the default resource
+class CountingResource : public std::pmr::memory_resource {
+  public:
+    int allocations = 0;
+    int deallocations = 0;
+
+  private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        ++deallocations;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+TEST(BigIntMemoryTests, Scope) {
+    CountingResource resource;
+    BigInteger outside = random_bigint(1000);
+    ASSERT_EQ(outside.get_memory_resource(), std::pmr::new_delete_resource());
+    {
+        BigInteger::MemoryScope scope(&resource);
+        ASSERT_EQ(BigInteger::memory_resource(), &resource);
+        BigInteger copy = outside;
+        ASSERT_EQ(copy.get_memory_resource(), &resource);
+        BigInteger product = copy * outside + copy;
+        ASSERT_EQ(product.get_memory_resource(), &resource);
+        ASSERT_GT(resource.allocations, 0);
+        // the assigned number keeps its resource
+        outside = std::move(product);
+        ASSERT_EQ(outside.get_memory_resource(), std::pmr::new_delete_resource());
+        ASSERT_EQ(outside, copy * copy + copy);
+        outside *= copy;
+        ASSERT_EQ(outside.get_memory_resource(), std::pmr::new_delete_resource());
+    }
+    ASSERT_EQ(resource.allocations, resource.deallocations);
+    ASSERT_EQ(BigInteger::memory_resource(), std::pmr::new_delete_resource());
+    BigInteger copy(outside, &resource);
+    ASSERT_EQ(copy.get_memory_resource(), &resource);
+    ASSERT_EQ(copy, outside);
+    BigInteger moved = std::move(copy);
+    ASSERT_EQ(moved.get_memory_resource(), &resource);
+}
+
+TEST(BigIntMemoryTests, Round) {
+    BigInteger a = random_bigint(1000);
+    BigInteger result;
+    for (int i = 0; i < 3; ++i) {
+        OperatorNewCounter cntr;
+        {
+            BigInteger::Round round;
+            BigInteger b = a * a;
+            ASSERT_NE(b.get_memory_resource(), std::pmr::new_delete_resource());
+            b /= a - 1;
+            result = b - a;
+        }
+        // the memory of the first round is reused by the next ones
+        if (i > 0) {
+            ASSERT_EQ(0, cntr.get_counter());
+        }
+        ASSERT_EQ(result, 1);
+    }
+    ASSERT_EQ(result.get_memory_resource(), std::pmr::new_delete_resource());
+}
+
+TEST(BigIntMemoryTests, ThreadPool) {
+    BigInteger a = random_bigint(1000);
+    // the first number takes the memory of the pool from the heap
+    BigInteger(a, BigInteger::thread_pool());
+    OperatorNewCounter cntr;
+    for (int i = 0; i < 3; ++i) {
+        BigInteger b(a, BigInteger::thread_pool());
+        ASSERT_EQ(b.get_memory_resource(), BigInteger::thread_pool());
+        ASSERT_EQ(b, a);
+        b += a;
+    }
+    ASSERT_EQ(0, cntr.get_counter());
+}
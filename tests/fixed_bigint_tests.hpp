@@ -0,0 +1,89 @@
+#pragma once
+
+#include "bigint_test_helper.hpp"
+#include "fixed_bigint.hpp"
+
+template <size_t Bits>
+FixedBigInt<Bits> random_fixed(size_t limbs = Bits / 64) {
+    FixedBigInt<Bits> value;
+    for (size_t i = 0; i < limbs; ++i) {
+        value[i] = (uint64_t(test_random()) << 32) | test_random();
+    }
+    return value;
+}
+
+template <size_t Bits>
+void check_fixed_against_bigint() {
+    BigInteger radix = BigInteger(1);
+    for (size_t i = 0; i < Bits / 64; ++i) {
+        radix *= BigInteger(1ll << 32);
+        radix *= BigInteger(1ll << 32);
+    }
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+        auto a = random_fixed<Bits>();
+        auto b = random_fixed<Bits>();
+        BigInteger x(a);
+        BigInteger y(b);
+        ASSERT_EQ(a, FixedBigInt<Bits>(x));
+        ASSERT_EQ((x + y) % radix, BigInteger(a + b));
+        ASSERT_EQ((x - y + radix) % radix, BigInteger(a - b));
+        ASSERT_EQ(x < y, a < b);
+        ASSERT_EQ(x * y, BigInteger(FixedBigInt<Bits>::multiply(a, b)));
+
+        auto n = random_fixed<Bits>();
+        n[0] |= 1;
+        typename FixedBigInt<Bits>::Montgomery modulus(n);
+        BigInteger m(n);
+        auto c = FixedBigInt<Bits>(x % m);
+        auto d = FixedBigInt<Bits>(y % m);
+        ASSERT_EQ(BigInteger(c) * BigInteger(d) % m,
+                  BigInteger(modulus.multiply_mod(c, d)));
+        ASSERT_EQ(c, modulus.from_montgomery(modulus.to_montgomery(c)));
+    }
+}
+
+TEST(FixedBigIntTests, SameAsBigInt) {
+    check_fixed_against_bigint<64>();
+    check_fixed_against_bigint<256>();
+    check_fixed_against_bigint<512>();
+    check_fixed_against_bigint<1024>();
+    check_fixed_against_bigint<2048>();
+    check_fixed_against_bigint<4096>();
+}
+
+TEST(FixedBigIntTests, Carries) {
+    FixedBigInt<256> ones;
+    for (size_t i = 0; i < FixedBigInt<256>::LIMBS; ++i) {
+        ones[i] = ~uint64_t(0);
+    }
+    auto sum = ones;
+    ASSERT_EQ(1, sum.add(FixedBigInt<256>(1)));
+    ASSERT_TRUE(sum.is_zero());
+    ASSERT_EQ(1, sum.sub(FixedBigInt<256>(1)));
+    ASSERT_EQ(ones, sum);
+}
+
+TEST(FixedBigIntTests, Constexpr) {
+    constexpr FixedBigInt<256> a = FixedBigInt<256>(5) + FixedBigInt<256>(7);
+    static_assert(a == FixedBigInt<256>(12));
+    constexpr FixedBigInt<256>::Montgomery modulus(FixedBigInt<256>(13));
+    static_assert(modulus.multiply_mod(5, 7) == FixedBigInt<256>(9));
+}
+
+TEST(FixedBigIntTests, SmallModuli) {
+    for (uint64_t n : {1, 3, 5, 7, 1000000007}) {
+        FixedBigInt<128>::Montgomery modulus(n);
+        for (uint64_t a = 0; a < std::min<uint64_t>(n, 20); ++a) {
+            ASSERT_EQ(FixedBigInt<128>(a * (a + 1) % n),
+                      modulus.multiply_mod(a, (a + 1) % n)) << n;
+        }
+    }
+}
+
+TEST(FixedBigIntTests, Errors) {
+    ASSERT_THROW(FixedBigInt<64>(BigInteger(-1)), std::out_of_range);
+    ASSERT_THROW(FixedBigInt<64>(BigInteger("18446744073709551616")),
+                 std::out_of_range);
+    ASSERT_THROW(FixedBigInt<64>::Montgomery(FixedBigInt<64>(10)),
+                 std::logic_error);
+}
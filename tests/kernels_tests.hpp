@@ -0,0 +1,120 @@
+#pragma once
+
+#include "kernels.hpp"
+#include "multiply_tests.hpp"
+
+const Kernels::Implementation KERNELS_IMPLEMENTATIONS[] = {
+    Kernels::Implementation::kGeneric, Kernels::Implementation::kADX,
+    Kernels::Implementation::kAVX2};
+
+// random limbs with long runs of zeros and all ones, so that carries and
+// borrows go through many limbs
+std::vector<uint64_t> carry_limbs(size_t size) {
+    auto limbs = random_limbs(size);
+    for (auto& limb : limbs) {
+        if (test_random() % 3 == 0) {
+            limb = test_random() % 2 ? ~uint64_t(0) : 0;
+        }
+    }
+    return limbs;
+}
+
+template <typename Kernel>
+void check_kernel_same_as_generic(Kernel kernel) {
+    for (size_t size = 0; size < 70; ++size) {
+        for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+            auto a = carry_limbs(size);
+            auto b = carry_limbs(size);
+            std::vector<uint64_t> expected(size);
+            std::vector<uint64_t> result(size);
+            auto implementation = Kernels::get_implementation();
+            Kernels::set_implementation(Kernels::Implementation::kGeneric);
+            uint64_t expected_carry = kernel(expected.data(), a.data(), b.data(), size);
+            Kernels::set_implementation(implementation);
+            ASSERT_EQ(expected_carry, kernel(result.data(), a.data(), b.data(), size));
+            ASSERT_EQ(expected, result) << size;
+            // in place
+            ASSERT_EQ(expected_carry, kernel(a.data(), a.data(), b.data(), size));
+            ASSERT_EQ(expected, a) << size;
+        }
+    }
+}
+
+TEST(KernelsTests, SameAsGeneric) {
+    auto initial = Kernels::get_implementation();
+    for (auto implementation : KERNELS_IMPLEMENTATIONS) {
+        if (!Kernels::is_supported(implementation)) {
+            continue;
+        }
+        Kernels::set_implementation(implementation);
+        check_kernel_same_as_generic(Kernels::add_n);
+        check_kernel_same_as_generic(Kernels::sub_n);
+    }
+    Kernels::set_implementation(initial);
+}
+
+TEST(KernelsTests, AddSubCarryThrough) {
+    auto initial = Kernels::get_implementation();
+    for (auto implementation : KERNELS_IMPLEMENTATIONS) {
+        if (!Kernels::is_supported(implementation)) {
+            continue;
+        }
+        Kernels::set_implementation(implementation);
+        for (size_t size = 1; size < 20; ++size) {
+            std::vector<uint64_t> ones(size, ~uint64_t(0));
+            std::vector<uint64_t> one(size, 0);
+            one[0] = 1;
+            std::vector<uint64_t> res(size);
+            ASSERT_EQ(1, Kernels::add_n(res.data(), ones.data(), one.data(), size));
+            ASSERT_EQ(std::vector<uint64_t>(size, 0), res);
+            ASSERT_EQ(1, Kernels::sub_n(res.data(), res.data(), one.data(), size));
+            ASSERT_EQ(ones, res);
+        }
+    }
+    Kernels::set_implementation(initial);
+}
+
+TEST(KernelsTests, AddMul) {
+    for (size_t size = 0; size < 40; ++size) {
+        auto res = carry_limbs(size);
+        auto a = carry_limbs(size);
+        uint64_t multiplier = test_random() % 2 ? ~uint64_t(0) : a.empty() ? 3 : a[0];
+        std::vector<uint64_t> product(size + 1);
+        Multiply::schoolbook(a.data(), size, &multiplier, 1, product.data());
+        std::vector<uint64_t> expected = res;
+        expected.push_back(Kernels::add_n(expected.data(), expected.data(),
+                                          product.data(), size));
+        expected.back() += product[size];
+        uint64_t carry = Kernels::addmul_1(res.data(), a.data(), size, multiplier);
+        res.push_back(carry);
+        ASSERT_EQ(expected, res) << size;
+    }
+}
+
+TEST(KernelsTests, ArithmeticWithEveryImplementation) {
+    auto initial = Kernels::get_implementation();
+    for (auto implementation : KERNELS_IMPLEMENTATIONS) {
+        if (!Kernels::is_supported(implementation)) {
+            continue;
+        }
+        Kernels::set_implementation(implementation);
+        for (auto [a_size, b_size] : MULTIPLY_TEST_SIZES) {
+            check_same_as_schoolbook(with_scratch<Multiply::karatsuba>, a_size, b_size);
+        }
+        BigInteger a = random_bigint(500);
+        BigInteger b = random_bigint(300);
+        ASSERT_EQ(a, (a + b) - b);
+        ASSERT_EQ(a, (a - b * b) + b * b);
+        ASSERT_EQ(a, (a * b) / b);
+    }
+    Kernels::set_implementation(initial);
+}
+
+TEST(KernelsTests, Unsupported) {
+    for (auto implementation : KERNELS_IMPLEMENTATIONS) {
+        if (!Kernels::is_supported(implementation)) {
+            ASSERT_THROW(Kernels::set_implementation(implementation), std::logic_error);
+        }
+    }
+    ASSERT_TRUE(Kernels::is_supported(Kernels::Implementation::kGeneric));
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "kernels_tests.hpp"
+#include "limbs.hpp"
+
+using LimbSpan = std::span<uint64_t>;
+
+TEST(LimbsTests, AddSub) {
+    for (size_t a_size = 0; a_size < 20; ++a_size) {
+        for (size_t b_size = 0; b_size <= a_size; ++b_size) {
+            auto a = carry_limbs(a_size);
+            auto b = carry_limbs(b_size);
+            std::vector<uint64_t> sum(a_size);
+            uint64_t carry = Limbs::add(sum, a, b);
+            std::vector<uint64_t> difference(a_size);
+            ASSERT_EQ(carry, Limbs::sub(difference, sum, b));
+            ASSERT_EQ(a, difference) << a_size << " " << b_size;
+            // in place
+            ASSERT_EQ(carry, Limbs::add(a, a, b));
+            ASSERT_EQ(sum, a);
+        }
+    }
+    std::vector<uint64_t> ones(5, ~uint64_t(0));
+    std::vector<uint64_t> zeros(5);
+    ASSERT_EQ(1, Limbs::add_1(ones, ones, 1));
+    ASSERT_EQ(zeros, ones);
+    ASSERT_EQ(1, Limbs::sub_1(ones, ones, 1));
+    ASSERT_EQ(std::vector<uint64_t>(5, ~uint64_t(0)), ones);
+    ASSERT_EQ(0, Limbs::add_1(zeros, zeros, 0));
+}
+
+TEST(LimbsTests, Compare) {
+    std::vector<uint64_t> a = {1, 2, 0, 0};
+    std::vector<uint64_t> b = {5, 1};
+    ASSERT_EQ(std::strong_ordering::greater, Limbs::compare(a, b));
+    ASSERT_EQ(std::strong_ordering::less,
+              Limbs::compare_n(std::span(b), std::span(a).first(2)));
+    ASSERT_EQ(2, Limbs::trimmed_size(a));
+    ASSERT_EQ(std::strong_ordering::equal,
+              Limbs::compare(a, std::vector<uint64_t>{1, 2}));
+    ASSERT_EQ(std::strong_ordering::equal,
+              Limbs::compare(std::vector<uint64_t>{0}, {}));
+}
+
+TEST(LimbsTests, MultiplyByLimb) {
+    for (size_t size = 0; size < 40; ++size) {
+        auto a = carry_limbs(size);
+        uint64_t multiplier = random_limbs(1)[0];
+        std::vector<uint64_t> expected(size + 1);
+        Multiply::schoolbook(a.data(), size, &multiplier, 1, expected.data());
+        std::vector<uint64_t> product(size + 1);
+        product[size] = Limbs::mul_1(LimbSpan(product).first(size), a,
+                                     multiplier);
+        ASSERT_EQ(expected, product) << size;
+
+        auto c = carry_limbs(size);
+        auto sum = c;
+        uint64_t carry = Limbs::addmul_1(sum, a, multiplier);
+        ASSERT_EQ(carry, Limbs::submul_1(sum, a, multiplier));
+        ASSERT_EQ(c, sum) << size;
+    }
+}
+
+TEST(LimbsTests, MulSqr) {
+    for (auto [a_size, b_size] : MULTIPLY_TEST_SIZES) {
+        auto a = random_limbs(a_size);
+        auto b = random_limbs(b_size);
+        std::vector<uint64_t> expected(a_size + b_size);
+        std::vector<uint64_t> result(a_size + b_size);
+        Multiply::schoolbook(a.data(), a_size, b.data(), b_size, expected.data());
+        std::vector<uint64_t> scratch(Limbs::mul_scratch_size(a_size, b_size));
+        Limbs::mul(result, a, b, scratch);
+        ASSERT_EQ(expected, result) << a_size << " x " << b_size;
+        Limbs::mul(result, b, a, scratch);
+        ASSERT_EQ(expected, result) << b_size << " x " << a_size;
+
+        std::vector<uint64_t> expected_square(2 * a_size);
+        std::vector<uint64_t> square(2 * a_size);
+        Multiply::schoolbook(a.data(), a_size, a.data(), a_size,
+                             expected_square.data());
+        scratch.resize(Limbs::sqr_scratch_size(a_size));
+        Limbs::sqr(square, a, scratch);
+        ASSERT_EQ(expected_square, square) << a_size;
+    }
+    ASSERT_EQ(0, Limbs::mul_scratch_size(1000, 1));
+    ASSERT_EQ(0, Limbs::sqr_scratch_size(1));
+    std::vector<uint64_t> result = {1, 2};
+    Limbs::mul(result, std::vector<uint64_t>{}, std::vector<uint64_t>{3, 4}, {});
+    ASSERT_EQ(std::vector<uint64_t>(2), result);
+}
+
+TEST(LimbsTests, Shifts) {
+    for (unsigned shift = 0; shift < 64; ++shift) {
+        auto a = random_limbs(7);
+        std::vector<uint64_t> shifted(7);
+        uint64_t overflow = Limbs::lshift(shifted, a, shift);
+        ASSERT_EQ(shift == 0 ? 0 : a.back() >> (64 - shift), overflow);
+        std::vector<uint64_t> back(7);
+        ASSERT_EQ(0, Limbs::rshift(back, shifted, shift));
+        back.back() |= shift == 0 ? 0 : overflow << (64 - shift);
+        ASSERT_EQ(a, back) << shift;
+    }
+}
+
+// checks a = quotient * d + remainder with remainder < d
+void check_division(const std::vector<uint64_t>& a,
+                    const std::vector<uint64_t>& d) {
+    std::vector<uint64_t> quotient(a.size() - d.size() + 1);
+    std::vector<uint64_t> remainder(d.size());
+    // the scratch space is all that it takes
+    const uint64_t CANARY = 0x5a5a5a5a5a5a5a5a;
+    std::vector<uint64_t> division_scratch(
+        Limbs::divrem_scratch_size(a.size(), d.size()) + 1, CANARY);
+    {
+        OperatorNewCounter cntr;
+        Limbs::divrem(quotient, remainder, a, d, division_scratch);
+        ASSERT_EQ(0, cntr.get_counter());
+    }
+    ASSERT_EQ(CANARY, division_scratch.back());
+    ASSERT_EQ(std::strong_ordering::less, Limbs::compare(remainder, d));
+    std::vector<uint64_t> product(quotient.size() + d.size());
+    std::vector<uint64_t> scratch(Limbs::mul_scratch_size(quotient.size(), d.size()));
+    Limbs::mul(product, quotient, d, scratch);
+    ASSERT_EQ(0, Limbs::add(product, product, remainder));
+    ASSERT_EQ(std::strong_ordering::equal, Limbs::compare(product, a))
+        << a.size() << " / " << d.size();
+
+    // the remainder in place of the dividend
+    auto dividend = a;
+    Limbs::divrem(quotient, LimbSpan(dividend).first(d.size()), dividend, d,
+                  division_scratch);
+    ASSERT_EQ(remainder, std::vector(dividend.begin(), dividend.begin() + d.size()));
+}
+
+TEST(LimbsTests, Divrem) {
+    for (size_t d_size = 1; d_size < 12; ++d_size) {
+        for (size_t a_size = d_size; a_size < d_size + 12; ++a_size) {
+            for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+                auto a = carry_limbs(a_size);
+                auto d = carry_limbs(d_size);
+                if (d.back() == 0) {
+                    d.back() = 1;
+                }
+                check_division(a, d);
+            }
+        }
+    }
+    // the quotient estimation is one too much and the divisor is added back
+    check_division({0, 0, 0x8000000000000000ull, 0x7fffffffffffffffull},
+                   {1, 0, 0x8000000000000000ull});
+    std::vector<uint64_t> quotient(2);
+    ASSERT_EQ(3, Limbs::divrem_1(quotient, std::vector<uint64_t>{13, 0}, 5));
+    ASSERT_EQ(std::vector<uint64_t>({2, 0}), quotient);
+    std::vector<uint64_t> remainder(2);
+    std::vector<uint64_t> scratch(Limbs::divrem_scratch_size(2, 2));
+    ASSERT_THROW(Limbs::divrem(quotient, remainder, std::vector<uint64_t>{1, 2},
+                               std::vector<uint64_t>{1, 0}, scratch),
+                 std::logic_error);
+}
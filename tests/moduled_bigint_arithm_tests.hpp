@@ -194,6 +194,12 @@ void check_test_multiple_big_n(Test test) {
   }
 }
 
+TEST(ModuledBigIntBigNTests, DefaultModulus) {
+  static_assert(ModuledBigInt::DEFAULT_N != BigInteger());
+  ASSERT_EQ(BigInteger("2760698538716225514973902344910793166845871614262060"
+                       "1169954803000803329"),
+            ModuledBigInt::DEFAULT_N);
+}
 
 TEST(ModuledBigIntBigNTests, SimpleTests) {
   check_test_multiple_big_n([]() {
@@ -222,6 +228,49 @@ TEST(ModuledBigIntBigNTests, AgreedWithBigIntOps) {
   });
 }
 
+TEST(ModuledBigIntBigNTests, Square) {
+  check_test_multiple_big_n([]() {
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+      ModuledBigInt a = random_bigint(100);
+      ASSERT_EQ(a * ModuledBigInt(a), a.square());
+    }
+  });
+}
+
+TEST(ModuledBigIntBigNTests, Bytes) {
+  check_test_multiple_big_n([]() {
+    size_t size = ModuledBigInt::byte_size();
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+      ModuledBigInt a = random_bigint(100);
+      auto bytes = a.to_bytes();
+      ASSERT_EQ(size, bytes.size());
+      ASSERT_EQ(a, ModuledBigInt::from_bytes(bytes));
+      std::vector<uint8_t> buffer(size);
+      a.to_bytes(buffer, ModuledBigInt::ByteOrder::kLittleEndian);
+      ASSERT_EQ(a, ModuledBigInt::from_bytes(
+                       buffer, ModuledBigInt::ByteOrder::kLittleEndian));
+    }
+    auto n_bytes = ModuledBigInt::N.to_bytes(size);
+    ASSERT_THROW(ModuledBigInt::from_bytes(n_bytes), std::out_of_range);
+    n_bytes.push_back(0);
+    ASSERT_THROW(ModuledBigInt::from_bytes(n_bytes), std::length_error);
+  });
+}
+
+TEST(ModuledBigIntBigNTests, AddMul) {
+  check_test_multiple_big_n([]() {
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+      ModuledBigInt a = random_bigint(100);
+      ModuledBigInt b = random_bigint(100);
+      ModuledBigInt c = random_bigint(1 + i % 20);
+      ModuledBigInt sum = a;
+      ASSERT_EQ(a + b * c, sum.addmul(b, c));
+      ModuledBigInt difference = a;
+      ASSERT_EQ(a - b * c, difference.submul(b, c));
+    }
+  });
+}
+
 TEST(ModuledBigIntBigNTests, UnaryMinus) {
   check_test_multiple_big_n([]() {
     for (size_t i = 0; i < 20; ++i) {
@@ -298,3 +347,225 @@ TEST(ModuledBigIntBigNTests, InverseTests) {
     }
   });
 }
+
+
+TEST(ModuledBigIntBigNTests, InlineMemory) {
+  ModuledBigInt::N = BigInteger(
+      "27606985387162255149739023449107931668458716142620601169954803000803329");
+  for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+    ModuledBigInt a = random_bigint(100);
+    ModuledBigInt b = random_bigint(100);
+    OperatorNewCounter cntr;
+    a *= b;
+    a += b;
+    a -= b;
+    ModuledBigInt c = a * b - a;
+    ASSERT_EQ(0, cntr.get_counter());
+  }
+}
+
+TEST(ModuledBigIntBigNTests, RvalueOperators) {
+  check_test_multiple_big_n([]() {
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+      ModuledBigInt a = random_bigint(100);
+      ModuledBigInt b = random_bigint(100);
+      ASSERT_EQ(a + b, ModuledBigInt(a) + b);
+      ASSERT_EQ(a + b, a + ModuledBigInt(b));
+      ASSERT_EQ(a + b, ModuledBigInt(a) + ModuledBigInt(b));
+      ASSERT_EQ(a - b, ModuledBigInt(a) - b);
+      ASSERT_EQ(a - b, a - ModuledBigInt(b));
+      ASSERT_EQ(a - b, ModuledBigInt(a) - ModuledBigInt(b));
+      ASSERT_EQ(a * b, ModuledBigInt(a) * b);
+      ASSERT_EQ(a * b, a * ModuledBigInt(b));
+      ASSERT_EQ(a * b, ModuledBigInt(a) * ModuledBigInt(b));
+      ASSERT_EQ(-a, -ModuledBigInt(a));
+    }
+    ASSERT_EQ(ModuledBigInt(0), -ModuledBigInt(0));
+  });
+}
+
+TEST(ModuledBigIntBigNTests, Prepared) {
+  check_test_multiple_big_n([]() {
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+      ModuledBigInt a = random_bigint(100);
+      ModuledBigInt b = random_bigint(100);
+      ModuledBigInt::Prepared prepared(b);
+      ASSERT_EQ(prepared.get_value(), b.get_value());
+      ASSERT_EQ(a * prepared, a * b);
+      ModuledBigInt c = a;
+      c *= prepared;
+      ASSERT_EQ(c, a * b);
+    }
+  });
+}
+
+TEST(ModuledBigIntBigNTests, MemoryResource) {
+  ModuledBigInt::N = random_bigint(400);
+  ModuledBigInt a = random_bigint(300);
+  ModuledBigInt b = random_bigint(300);
+  ModuledBigInt product;
+  {
+    BigInteger::Round round;
+    ModuledBigInt c(a, BigInteger::thread_pool());
+    ASSERT_EQ(c.get_memory_resource(), BigInteger::thread_pool());
+    ModuledBigInt d = b;
+    ASSERT_NE(d.get_memory_resource(), std::pmr::new_delete_resource());
+    product = c * d;
+  }
+  ASSERT_EQ(product.get_memory_resource(), std::pmr::new_delete_resource());
+  ASSERT_EQ(product, a * b);
+}
+
+// base^exponent by plain square-and-multiply
+ModuledBigInt naive_pow(const ModuledBigInt& base, BigInteger exponent) {
+  ModuledBigInt result = 1;
+  ModuledBigInt power = base;
+  while (!exponent.is_zero()) {
+    if (exponent % 2 == 1) {
+      result *= power;
+    }
+    power *= power;
+    exponent /= 2;
+  }
+  return result;
+}
+
+TEST(ModuledBigIntBigNTests, Pow) {
+  check_test_multiple_big_n([]() {
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+      ModuledBigInt a = random_bigint(100);
+      BigInteger e = abs(random_bigint(i * 10 + 1));
+      BigInteger f = abs(random_bigint(30));
+      ASSERT_EQ(naive_pow(a, e), pow(a, e));
+      ASSERT_EQ(pow(a, e) * pow(a, f), pow(a, e + f));
+    }
+    ModuledBigInt a = random_bigint(100);
+    ASSERT_EQ(ModuledBigInt(1), pow(a, 0));
+    ASSERT_EQ(a, pow(a, 1));
+    ASSERT_EQ(a.square(), pow(a, 2));
+  });
+}
+
+TEST(ModuledBigIntBigNTests, PowNegative) {
+  // 2^127 - 1 is prime, so every nonzero residue has an inverse
+  ModuledBigInt::N = BigInteger("170141183460469231731687303715884105727");
+  for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+    ModuledBigInt a = random_bigint(50);
+    BigInteger e = abs(random_bigint(40)) + 1;
+    ASSERT_EQ(ModuledBigInt(1), pow(a, e) * pow(a, -e));
+  }
+  ASSERT_THROW(pow(ModuledBigInt(0), -1), std::domain_error);
+  ModuledBigInt::N = ModuledBigInt::DEFAULT_N;
+}
+
+TEST(ModuledBigIntBigNTests, MultiPow) {
+  check_test_multiple_big_n([]() {
+    for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+      std::vector<ModuledBigInt> bases;
+      std::vector<BigInteger> exponents;
+      ModuledBigInt expected = 1;
+      for (int j = 0; j < i % 4 + 1; ++j) {
+        bases.push_back(random_bigint(100));
+        // zero exponents and exponents of different lengths
+        exponents.push_back(j == 2 ? BigInteger(0) : abs(random_bigint(j * 20 + 5)));
+        expected *= pow(bases.back(), exponents.back());
+      }
+      ASSERT_EQ(expected, ModuledBigInt::multi_pow(bases, exponents));
+    }
+    ASSERT_EQ(ModuledBigInt(1), ModuledBigInt::multi_pow({}, {}));
+  });
+  std::vector<ModuledBigInt> bases(2);
+  std::vector<BigInteger> exponents(1);
+  ASSERT_THROW(ModuledBigInt::multi_pow(bases, exponents), std::invalid_argument);
+}
+
+TEST(ModuledBigIntBigNTests, FixedBase) {
+  check_test_multiple_big_n([]() {
+    ModuledBigInt base = random_bigint(100);
+    for (unsigned teeth : {1, 4, 6}) {
+      ModuledBigInt::FixedBase fixed(base, 300, teeth);
+      ASSERT_EQ(base, fixed.base());
+      for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+        // up to 90 digits fit into 300 bits, the longer ones go to pow
+        BigInteger e = abs(random_bigint(i * 5 + 1));
+        ASSERT_EQ(pow(base, e), fixed.pow(e));
+      }
+      ASSERT_EQ(ModuledBigInt(1), fixed.pow(0));
+    }
+  });
+  ASSERT_THROW(ModuledBigInt::FixedBase(ModuledBigInt(2), 100, 0), std::invalid_argument);
+}
+
+// the same residues as ModuledBigInt under the same N, for the default N and
+// for an odd N of the full width
+template <size_t Bits>
+void check_fixed_moduled(const BigInteger& n) {
+  using Fixed = BasicModuledBigInt<FixedBigInt<Bits>>;
+  ModuledBigInt::N = n;
+  Fixed::N = typename Fixed::Modulus(FixedBigInt<Bits>(n));
+  for (int i = 0; i < RANDOM_TRIES_COUNT; ++i) {
+    BigInteger a = random_bigint(Bits / 3);
+    BigInteger b = random_bigint(Bits / 4);
+    long long c = random_value() - random_value();
+    ModuledBigInt x = a, y = b;
+    Fixed fx = a, fy = b;
+    auto same = [](const ModuledBigInt& expected, const Fixed& value) {
+      return expected.get_value() == BigInteger(value.get_value());
+    };
+    ASSERT_TRUE(same(x + y, fx + fy));
+    ASSERT_TRUE(same(x - y, fx - fy));
+    ASSERT_TRUE(same(x * y, fx * fy));
+    ASSERT_TRUE(same(-x, -fx));
+    ASSERT_TRUE(same(x.square(), fx.square()));
+    ASSERT_TRUE(same(ModuledBigInt(c), Fixed(c)));
+    ASSERT_TRUE(same(ModuledBigInt(c) * x, Fixed(c) * fx));
+    ASSERT_TRUE(same(ModuledBigInt(x).addmul(x, y), Fixed(fx).addmul(fx, fy)));
+    ASSERT_TRUE(same(ModuledBigInt(x).submul(y, y), Fixed(fx).submul(fy, fy)));
+    ASSERT_TRUE(same(x.inversed(), fx.inversed()));
+    ASSERT_EQ(x < y, fx < fy);
+    ASSERT_EQ(x == y, fx == fy);
+    BigInteger e = random_bigint(i % 30 + 1);
+    if (x.inversed() != ModuledBigInt() || !e.is_negative()) {
+      ASSERT_TRUE(same(pow(x, e), pow(fx, e)));
+    }
+    std::vector<Fixed> bases = {fx, fy};
+    std::vector<BigInteger> exponents = {abs(e), abs(a)};
+    ASSERT_TRUE(same(pow(x, abs(e)) * pow(y, abs(a)),
+                     Fixed::multi_pow(bases, exponents)));
+  }
+  ModuledBigInt::N = ModuledBigInt::DEFAULT_N;
+  Fixed::N = typename Fixed::Modulus(FixedBigInt<Bits>(ModuledBigInt::N));
+}
+
+TEST(FixedModuledBigIntTests, SameAsModuledBigInt) {
+  check_fixed_moduled<256>(ModuledBigInt::DEFAULT_N);
+  BigInteger full = BigInteger(1);
+  for (int i = 0; i < 1024; ++i) {
+    full *= 2;
+  }
+  check_fixed_moduled<1024>(full - 3);
+  check_fixed_moduled<1024>(ModuledBigInt::DEFAULT_N);
+}
+
+TEST(FixedModuledBigIntTests, DefaultModulus) {
+  using Fixed = BasicModuledBigInt<FixedBigInt<256>>;
+  ASSERT_EQ(ModuledBigInt::DEFAULT_N, BigInteger(Fixed::N.modulus()));
+  ASSERT_EQ(ModuledBigInt::DEFAULT_N - 1, BigInteger(Fixed(-1).get_value()));
+  std::stringstream out;
+  out << Fixed(12345);
+  ASSERT_EQ("12345", out.str());
+  ASSERT_THROW(pow(Fixed(0), BigInteger(-1)), std::domain_error);
+}
+
+TEST(FixedModuledBigIntTests, NoAllocations) {
+  using Fixed = BasicModuledBigInt<FixedBigInt<256>>;
+  Fixed a = random_bigint(70);
+  Fixed b = random_bigint(70);
+  OperatorNewCounter cntr;
+  for (int i = 0; i < 100; ++i) {
+    a = a * b + a.square() - b;
+    a.addmul(a, b);
+    b = -a;
+  }
+  ASSERT_EQ(0, cntr.get_counter());
+}
@@ -0,0 +1,337 @@
+#pragma once
+
+#include "bigint_test_helper.hpp"
+#include "fft.hpp"
+#include "multiply.hpp"
+#include "thresholds.hpp"
+
+std::vector<uint64_t> random_limbs(size_t size) {
+    std::vector<uint64_t> limbs(size);
+    for (auto& limb : limbs) {
+        limb = (uint64_t(test_random()) << 32) | test_random();
+    }
+    return limbs;
+}
+
+// the algorithms that take scratch space, with as much of it as they need
+template <auto Algorithm>
+void with_scratch(const uint64_t* a, size_t a_size, const uint64_t* b,
+                  size_t b_size, uint64_t* res) {
+    std::vector<uint64_t> scratch(Multiply::scratch_size(std::max(a_size, b_size)));
+    Algorithm(a, a_size, b, b_size, res, scratch.data());
+}
+
+template <auto Algorithm>
+void square_with_scratch(const uint64_t* a, size_t size, uint64_t* res) {
+    std::vector<uint64_t> scratch(Multiply::scratch_size(size));
+    Algorithm(a, size, res, scratch.data());
+}
+
+template <typename Algorithm>
+void check_same_as_schoolbook(Algorithm algorithm, size_t a_size, size_t b_size) {
+    auto a = random_limbs(a_size);
+    auto b = random_limbs(b_size);
+    std::vector<uint64_t> expected(a_size + b_size);
+    std::vector<uint64_t> result(a_size + b_size);
+    Multiply::schoolbook(a.data(), a_size, b.data(), b_size, expected.data());
+    algorithm(a.data(), a_size, b.data(), b_size, result.data());
+    ASSERT_EQ(expected, result) << a_size << " x " << b_size;
+}
+
+const std::vector<std::pair<size_t, size_t>> MULTIPLY_TEST_SIZES = {
+    {1, 1}, {2, 2}, {3, 2}, {7, 5}, {30, 30}, {31, 17}, {100, 99},
+    {150, 40}, {200, 200}, {301, 250}, {700, 20}, {1000, 999}};
+
+TEST(MultiplyTests, Karatsuba) {
+    for (auto [a_size, b_size] : MULTIPLY_TEST_SIZES) {
+        check_same_as_schoolbook(with_scratch<Multiply::karatsuba>, a_size, b_size);
+    }
+}
+
+TEST(MultiplyTests, Toom3) {
+    for (auto [a_size, b_size] : MULTIPLY_TEST_SIZES) {
+        check_same_as_schoolbook(with_scratch<Multiply::toom3>, a_size, b_size);
+    }
+}
+
+TEST(MultiplyTests, FFT) {
+    for (auto [a_size, b_size] : MULTIPLY_TEST_SIZES) {
+        check_same_as_schoolbook(Multiply::fft, a_size, b_size);
+    }
+}
+
+void multiply_allocating(const uint64_t* a, size_t a_size, const uint64_t* b,
+                         size_t b_size, uint64_t* res) {
+    Multiply::multiply(a, a_size, b, b_size, res);
+}
+
+void square_allocating(const uint64_t* a, size_t size, uint64_t* res) {
+    Multiply::square(a, size, res);
+}
+
+TEST(MultiplyTests, Dispatch) {
+    for (auto [a_size, b_size] : MULTIPLY_TEST_SIZES) {
+        check_same_as_schoolbook(multiply_allocating, a_size, b_size);
+    }
+    check_same_as_schoolbook(multiply_allocating, 2000, 1600);
+}
+
+TEST(MultiplyTests, Scratch) {
+    // the products stay within the scratch space and allocate nothing
+    // below the transform sizes
+    const uint64_t CANARY = 0x5a5a5a5a5a5a5a5a;
+    auto sizes = MULTIPLY_TEST_SIZES;
+    sizes.insert(sizes.end(), {{4, 4}, {5, 5}, {9, 8}, {64, 64}, {200, 70}});
+    for (auto [a_size, b_size] : sizes) {
+        auto a = random_limbs(a_size);
+        auto b = random_limbs(b_size);
+        std::vector<uint64_t> expected(a_size + b_size);
+        Multiply::schoolbook(a.data(), a_size, b.data(), b_size, expected.data());
+        std::vector<uint64_t> expected_square(2 * a_size);
+        Multiply::schoolbook(a.data(), a_size, a.data(), a_size,
+                             expected_square.data());
+        size_t size = std::max(Multiply::multiply_scratch_size(a_size, b_size),
+                               Multiply::square_scratch_size(a_size));
+        ASSERT_LE(size, Multiply::scratch_size(std::max(a_size, b_size)));
+        std::vector<uint64_t> scratch(size + 1, CANARY);
+        // every limb of the results is written
+        std::vector<uint64_t> result(a_size + b_size, CANARY);
+        std::vector<uint64_t> square(2 * a_size, CANARY);
+        OperatorNewCounter cntr;
+        Multiply::multiply(a.data(), a_size, b.data(), b_size, result.data(),
+                           scratch.data());
+        Multiply::square(a.data(), a_size, square.data(), scratch.data());
+        ASSERT_EQ(0, cntr.get_counter()) << a_size << " x " << b_size;
+        ASSERT_EQ(expected, result) << a_size << " x " << b_size;
+        ASSERT_EQ(expected_square, square) << a_size;
+        ASSERT_EQ(CANARY, scratch.back());
+    }
+    // the recursive algorithms forced on every size
+    for (size_t size = 1; size < 300; size += size / 8 + 1) {
+        for (size_t other : {size, size / 2 + 1, size / 3 + 1}) {
+            auto a = random_limbs(size);
+            auto b = random_limbs(other);
+            std::vector<uint64_t> expected(size + other);
+            Multiply::schoolbook(a.data(), size, b.data(), other, expected.data());
+            for (auto algorithm : {Multiply::karatsuba, Multiply::toom3}) {
+                std::vector<uint64_t> scratch(Multiply::scratch_size(size) + 1, CANARY);
+                std::vector<uint64_t> result(size + other, CANARY);
+                algorithm(a.data(), size, b.data(), other, result.data(),
+                          scratch.data());
+                ASSERT_EQ(expected, result) << size << " x " << other;
+                ASSERT_EQ(CANARY, scratch.back());
+            }
+        }
+    }
+}
+
+TEST(MultiplyTests, AllOnes) {
+    // the largest possible carries
+    for (auto [a_size, b_size] : MULTIPLY_TEST_SIZES) {
+        std::vector<uint64_t> a(a_size, ~uint64_t(0));
+        std::vector<uint64_t> b(b_size, ~uint64_t(0));
+        std::vector<uint64_t> expected(a_size + b_size);
+        std::vector<uint64_t> result(a_size + b_size);
+        Multiply::schoolbook(a.data(), a_size, b.data(), b_size, expected.data());
+        with_scratch<Multiply::toom3>(a.data(), a_size, b.data(), b_size, result.data());
+        ASSERT_EQ(expected, result);
+        with_scratch<Multiply::karatsuba>(a.data(), a_size, b.data(), b_size, result.data());
+        ASSERT_EQ(expected, result);
+    }
+}
+
+TEST(MultiplyTests, FFTPieceBits) {
+    unsigned previous = FFT::MAX_PIECE_BITS;
+    for (size_t size = 1; size <= (size_t(1) << 22); size *= 2) {
+        unsigned bits = FFT::piece_bits(size * 64, size * 64);
+        ASSERT_LE(bits, previous);
+        ASSERT_GE(bits, FFT::MIN_PIECE_BITS);
+        // the widest pieces within the bound
+        size_t pieces = (size * 64 + bits - 1) / bits;
+        double piece = std::ldexp(1.0, bits) - 1;
+        double norm = std::sqrt(double(pieces)) * piece;
+        ASSERT_LT(FFT::product_error_bound(norm, norm, FFT::transform_size(2 * pieces - 1)), 0.5);
+        if (bits < FFT::MAX_PIECE_BITS) {
+            size_t wider = (size * 64 + bits) / (bits + 1);
+            double wider_norm = std::sqrt(double(wider)) * (2 * piece + 1);
+            ASSERT_GE(FFT::product_error_bound(wider_norm, wider_norm, FFT::transform_size(2 * wider - 1)), 0.5);
+        }
+        previous = bits;
+    }
+    // the bound grows with the norms and the transform size
+    ASSERT_LT(FFT::error_bound(1e6, 1e6, 1024), FFT::error_bound(1e6, 1e6, 2048));
+    ASSERT_LT(FFT::error_bound(1e6, 1e6, 1024), FFT::error_bound(2e6, 1e6, 1024));
+    // the packed product is bounded by the mean square of the norms
+    ASSERT_EQ(FFT::error_bound(1e6, 1e6, 2048), FFT::product_error_bound(1e6, 1e6, 1024));
+    ASSERT_LT(FFT::error_bound(2e6, 1e6, 2048), FFT::product_error_bound(2e6, 1e6, 1024));
+}
+
+TEST(MultiplyTests, FFTAllOnes) {
+    // the largest coefficients around the sizes where the pieces get narrower
+    for (size_t size : {110, 125, 360, 375, 1200, 1215, 3900, 3950}) {
+        std::vector<uint64_t> a(size, ~uint64_t(0));
+        std::vector<uint64_t> b(size - 7, ~uint64_t(0));
+        std::vector<uint64_t> expected(a.size() + b.size());
+        std::vector<uint64_t> result(a.size() + b.size());
+        with_scratch<Multiply::toom3>(a.data(), a.size(), b.data(), b.size(), expected.data());
+        Multiply::fft(a.data(), a.size(), b.data(), b.size(), result.data());
+        ASSERT_EQ(expected, result) << size;
+        expected.resize(2 * size);
+        result.resize(2 * size);
+        square_with_scratch<Multiply::toom3_square>(a.data(), size, expected.data());
+        Multiply::fft_square(a.data(), size, result.data());
+        ASSERT_EQ(expected, result) << size;
+    }
+}
+
+TEST(MultiplyTests, FFTPlanCache) {
+    FFT::Plan* first = &FFT::cached_plan(1024);
+    FFT::Plan* second = &FFT::cached_plan(4096);
+    ASSERT_EQ(first, &FFT::cached_plan(1024));
+    ASSERT_EQ(second, &FFT::cached_plan(4096));
+    ASSERT_EQ(1024, first->size());
+    // the least recently used plan goes first
+    for (size_t i = 0; i < FFT::PLAN_CACHE_SIZE - 1; ++i) {
+        FFT::cached_plan(size_t(16) << i);
+    }
+    ASSERT_EQ(second, &FFT::cached_plan(4096));
+}
+
+TEST(MultiplyTests, FFTReusesPlans) {
+    // alternating sizes do not allocate once their plans are built
+    auto a = random_limbs(300);
+    auto b = random_limbs(200);
+    std::vector<uint64_t> product(a.size() + b.size());
+    std::vector<uint64_t> square(2 * a.size());
+    for (int round = 0; round < 3; ++round) {
+        OperatorNewCounter cntr;
+        Multiply::fft(a.data(), a.size(), b.data(), b.size(), product.data());
+        Multiply::fft_square(a.data(), a.size(), square.data());
+        Multiply::fft(a.data(), a.size(), a.data(), 20, product.data());
+        if (round > 0) {
+            ASSERT_EQ(0, cntr.get_counter());
+        }
+    }
+    std::vector<uint64_t> expected(2 * a.size());
+    Multiply::schoolbook(a.data(), a.size(), a.data(), a.size(), expected.data());
+    ASSERT_EQ(expected, square);
+}
+
+TEST(MultiplyTests, NTT) {
+    for (auto [a_size, b_size] : MULTIPLY_TEST_SIZES) {
+        check_same_as_schoolbook(Multiply::ntt, a_size, b_size);
+    }
+    std::vector<uint64_t> a(3000, ~uint64_t(0));
+    std::vector<uint64_t> expected(6000);
+    std::vector<uint64_t> result(6000);
+    with_scratch<Multiply::toom3>(a.data(), a.size(), a.data(), a.size(), expected.data());
+    Multiply::ntt(a.data(), a.size(), a.data(), a.size(), result.data());
+    ASSERT_EQ(expected, result);
+}
+
+TEST(MultiplyTests, LargeEngine) {
+    auto a = random_limbs(8000);
+    auto b = random_limbs(7500);
+    std::vector<uint64_t> expected(a.size() + b.size());
+    with_scratch<Multiply::toom3>(a.data(), a.size(), b.data(), b.size(), expected.data());
+    for (auto engine : {Multiply::Engine::kFFT, Multiply::Engine::kNTT}) {
+        Multiply::set_large_engine(engine);
+        std::vector<uint64_t> result(a.size() + b.size());
+        Multiply::multiply(a.data(), a.size(), b.data(), b.size(), result.data());
+        ASSERT_EQ(expected, result);
+        BigInteger first = random_bigint(40000);
+        BigInteger second = random_bigint(40000);
+        ASSERT_EQ((first * second) / second, first);
+    }
+}
+
+TEST(MultiplyTests, PreparedOperand) {
+    // both engines with operands at their thresholds, at the longest size
+    // the transform fits, and with the ones it does not fit
+    struct Case {
+        Multiply::Engine engine;
+        size_t b_size;
+        size_t max_other_size;
+    };
+    for (auto [engine, b_size, max_other_size] :
+         {Case{Multiply::Engine::kNTT, 7200, 7300},
+          Case{Multiply::Engine::kFFT, 16400, 16400}}) {
+        Multiply::set_large_engine(engine);
+        auto b = random_limbs(b_size);
+        Multiply::Prepared prepared(b.data(), b.size(), max_other_size);
+        ASSERT_TRUE(prepared.is_transformed());
+        size_t threshold = engine == Multiply::Engine::kNTT
+                               ? Thresholds::current().ntt
+                               : Thresholds::current().fft;
+        for (size_t a_size : {size_t(50), threshold, max_other_size,
+                              max_other_size + 1, 3 * max_other_size + 5}) {
+            auto a = random_limbs(a_size);
+            std::vector<uint64_t> expected(a_size + b_size);
+            std::vector<uint64_t> result(a_size + b_size);
+            with_scratch<Multiply::toom3>(a.data(), a_size, b.data(), b_size, expected.data());
+            prepared.multiply(a.data(), a_size, b.data(), b_size, result.data());
+            ASSERT_EQ(expected, result) << a_size;
+        }
+        std::vector<uint64_t> ones(max_other_size, ~uint64_t(0));
+        std::vector<uint64_t> all_ones(b_size, ~uint64_t(0));
+        Multiply::Prepared prepared_ones(all_ones.data(), b_size, max_other_size);
+        std::vector<uint64_t> expected(max_other_size + b_size);
+        std::vector<uint64_t> result(max_other_size + b_size);
+        with_scratch<Multiply::toom3>(ones.data(), max_other_size,
+                                      all_ones.data(), b_size, expected.data());
+        prepared_ones.multiply(ones.data(), max_other_size, all_ones.data(),
+                               b_size, result.data());
+        ASSERT_EQ(expected, result);
+    }
+    Multiply::set_large_engine(Multiply::Engine::kNTT);
+    // short operands are not transformed at all
+    auto c = random_limbs(100);
+    ASSERT_FALSE(Multiply::Prepared(c.data(), c.size(), c.size()).is_transformed());
+}
+
+TEST(MultiplyTests, Unbalanced) {
+    // one product of the whole operands, blocks with a single transform
+    // of the shorter one, and blocks of its length for the both engines
+    const std::vector<std::pair<size_t, size_t>> sizes = {
+        {2000, 40}, {20000, 7200}, {60000, 7500}, {50000, 17000}};
+    for (auto engine : {Multiply::Engine::kNTT, Multiply::Engine::kFFT}) {
+        Multiply::set_large_engine(engine);
+        for (auto [a_size, b_size] : sizes) {
+            auto a = random_limbs(a_size);
+            auto b = random_limbs(b_size);
+            std::vector<uint64_t> expected(a_size + b_size);
+            std::vector<uint64_t> result(a_size + b_size);
+            with_scratch<Multiply::toom3>(a.data(), a_size, b.data(), b_size, expected.data());
+            Multiply::multiply(a.data(), a_size, b.data(), b_size, result.data());
+            ASSERT_EQ(expected, result) << a_size << " x " << b_size;
+            Multiply::multiply(b.data(), b_size, a.data(), a_size, result.data());
+            ASSERT_EQ(expected, result) << b_size << " x " << a_size;
+        }
+    }
+    Multiply::set_large_engine(Multiply::Engine::kNTT);
+}
+
+template <typename Algorithm>
+void check_square_same_as_schoolbook(Algorithm algorithm, size_t size) {
+    auto a = random_limbs(size);
+    std::vector<uint64_t> expected(2 * size);
+    std::vector<uint64_t> result(2 * size);
+    Multiply::schoolbook(a.data(), size, a.data(), size, expected.data());
+    algorithm(a.data(), size, result.data());
+    ASSERT_EQ(expected, result) << size;
+    std::fill(a.begin(), a.end(), ~uint64_t(0));
+    Multiply::schoolbook(a.data(), size, a.data(), size, expected.data());
+    algorithm(a.data(), size, result.data());
+    ASSERT_EQ(expected, result) << size;
+}
+
+TEST(MultiplyTests, Square) {
+    for (size_t size : {1, 2, 3, 7, 30, 33, 100, 201, 500, 1000}) {
+        check_square_same_as_schoolbook(square_allocating, size);
+        check_square_same_as_schoolbook(Multiply::schoolbook_square, size);
+        check_square_same_as_schoolbook(square_with_scratch<Multiply::karatsuba_square>, size);
+        check_square_same_as_schoolbook(square_with_scratch<Multiply::toom3_square>, size);
+        check_square_same_as_schoolbook(Multiply::fft_square, size);
+        check_square_same_as_schoolbook(Multiply::ntt_square, size);
+    }
+}
@@ -5,8 +5,15 @@
 #include "bigint_arithm_tests.hpp"
 #include "bigint_equalities_tests.hpp"
 #include "bigint_types_tests.hpp"
+#include "multiply_tests.hpp"
+#include "kernels_tests.hpp"
+#include "limbs_tests.hpp"
+#include "fixed_bigint_tests.hpp"
+#include "thresholds_tests.hpp"
 // moduled bigint tests
 #include "moduled_bigint_arithm_tests.hpp"
+// multithreaded stress tests
+#include "thread_safety_tests.hpp"
 
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
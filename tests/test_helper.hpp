@@ -20,11 +20,15 @@ long long random_value() {
     return (test_random() % static_cast<long long>(1e9 + 7));
 }
 
+// counts both scalar and array allocations made while it is alive
 class OperatorNewCounter {
   private:
     int counter = 0;
     size_t total_size = 0;
-    static std::set<OperatorNewCounter*> instances;
+    // intrusive list, so that it is usable before any static initialization
+    // and does not allocate itself
+    OperatorNewCounter* next = nullptr;
+    static OperatorNewCounter* instances;
     
     void notify(size_t size) {
         ++counter;
@@ -32,12 +36,12 @@ class OperatorNewCounter {
     }
 
   public:
-    OperatorNewCounter() {
-        instances.insert(this);
+    OperatorNewCounter() : next(instances) {
+        instances = this;
     }
 
     static void notify_all(size_t size) {
-        for (auto item : instances) {
+        for (auto item = instances; item != nullptr; item = item->next) {
             item->notify(size);
         }
     }
@@ -52,19 +56,59 @@ class OperatorNewCounter {
     
 
     ~OperatorNewCounter() {
-        instances.erase(this);
+        OperatorNewCounter** item = &instances;
+        while (*item != this) {
+            item = &(*item)->next;
+        }
+        *item = next;
     }
 };
 
-std::set<OperatorNewCounter*> OperatorNewCounter::instances = std::set<OperatorNewCounter*>();
+OperatorNewCounter* OperatorNewCounter::instances = nullptr;
 
-void* operator new[] (size_t size) {
+void* counted_malloc(size_t size) {
     OperatorNewCounter::notify_all(size);
     void* p = malloc(size);
     if (p == nullptr) throw std::bad_alloc();
     return p;
 }
 
+void* operator new(size_t size) {
+    return counted_malloc(size);
+}
+
+void* operator new[] (size_t size) {
+    return counted_malloc(size);
+}
+
+// the runtime uses the nothrow versions itself, e.g. for thread_local
+// destructors, they must match the replaced delete
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    OperatorNewCounter::notify_all(size);
+    return malloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    OperatorNewCounter::notify_all(size);
+    return malloc(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
 class Timer {
   private:
     steady_clock::time_point begin;
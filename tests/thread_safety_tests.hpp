@@ -0,0 +1,210 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "multiply_tests.hpp"
+#include "moduled_bigint.hpp"
+#include "parallel.hpp"
+
+const size_t STRESS_THREADS_COUNT = 8;
+
+// runs check(thread_index) on several threads at once, it returns
+// the number of wrong results
+template <typename Check>
+int run_concurrently(Check check) {
+    std::atomic<int> failures = 0;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < STRESS_THREADS_COUNT; ++i) {
+        threads.emplace_back([&, i]() { failures += check(i); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return failures;
+}
+
+TEST(ThreadSafetyTests, FFT) {
+    // every thread goes through its own sequence of sizes, so that
+    // transforms of different lengths run at the same time
+    const std::vector<size_t> sizes = {40, 97, 300, 513, 1000, 1500};
+    std::vector<std::vector<uint64_t>> a, b, expected;
+    for (size_t size : sizes) {
+        a.push_back(random_limbs(size));
+        b.push_back(random_limbs(size / 2 + 1));
+        expected.emplace_back(a.back().size() + b.back().size());
+        with_scratch<Multiply::karatsuba>(a.back().data(), a.back().size(),
+                                          b.back().data(), b.back().size(),
+                                          expected.back().data());
+    }
+    int failures = run_concurrently([&](size_t thread) {
+        int wrong = 0;
+        for (size_t round = 0; round < 3 * sizes.size(); ++round) {
+            size_t k = (thread + round) % sizes.size();
+            std::vector<uint64_t> result(expected[k].size());
+            Multiply::fft(a[k].data(), a[k].size(), b[k].data(), b[k].size(),
+                          result.data());
+            wrong += result != expected[k];
+            std::vector<uint64_t> square(2 * a[k].size());
+            Multiply::fft_square(a[k].data(), a[k].size(), square.data());
+            std::vector<uint64_t> square_expected(2 * a[k].size());
+            square_with_scratch<Multiply::karatsuba_square>(
+                a[k].data(), a[k].size(), square_expected.data());
+            wrong += square != square_expected;
+        }
+        return wrong;
+    });
+    ASSERT_EQ(0, failures);
+}
+
+TEST(ThreadSafetyTests, NTT) {
+    const std::vector<size_t> sizes = {30, 257, 700, 1200};
+    std::vector<std::vector<uint64_t>> a, expected;
+    for (size_t size : sizes) {
+        a.push_back(random_limbs(size));
+        expected.emplace_back(2 * size);
+        square_with_scratch<Multiply::karatsuba_square>(a.back().data(), size,
+                                                        expected.back().data());
+    }
+    int failures = run_concurrently([&](size_t thread) {
+        int wrong = 0;
+        for (size_t round = 0; round < 2 * sizes.size(); ++round) {
+            size_t k = (thread + round) % sizes.size();
+            std::vector<uint64_t> result(expected[k].size());
+            Multiply::ntt(a[k].data(), a[k].size(), a[k].data(), a[k].size(),
+                          result.data());
+            wrong += result != expected[k];
+        }
+        return wrong;
+    });
+    ASSERT_EQ(0, failures);
+}
+
+TEST(ThreadSafetyTests, ModuledBigInt) {
+    ModuledBigInt::N = BigInteger(
+        "27606985387162255149739023449107931668458716142620601169954803000803329");
+    std::vector<ModuledBigInt> values;
+    for (size_t i = 0; i < STRESS_THREADS_COUNT; ++i) {
+        values.push_back(random_bigint(70));
+    }
+    std::vector<ModuledBigInt> expected;
+    for (const auto& value : values) {
+        ModuledBigInt power = 1;
+        for (int i = 0; i < 200; ++i) {
+            power = power * value + value.square();
+        }
+        expected.push_back(power);
+    }
+    int failures = run_concurrently([&](size_t thread) {
+        const ModuledBigInt& value = values[thread];
+        ModuledBigInt power = 1;
+        for (int i = 0; i < 200; ++i) {
+            power = power * value + value.square();
+        }
+        return int(power != expected[thread] ||
+                   std::string(power.get_value()) !=
+                       std::string(expected[thread].get_value()));
+    });
+    ASSERT_EQ(0, failures);
+}
+
+// operands with their product and the square of the first one, all made
+// with a single thread
+struct ParallelCase {
+    std::vector<uint64_t> a, b, product, square;
+};
+
+std::vector<ParallelCase> parallel_cases(const std::vector<size_t>& sizes) {
+    auto threads = Parallel::get_threads();
+    Parallel::set_threads(1);
+    std::vector<ParallelCase> cases;
+    for (size_t size : sizes) {
+        ParallelCase item{random_limbs(size), random_limbs(size - size / 5), {}, {}};
+        item.product.resize(item.a.size() + item.b.size());
+        Multiply::multiply(item.a.data(), item.a.size(), item.b.data(), item.b.size(),
+                           item.product.data());
+        item.square.resize(2 * item.a.size());
+        Multiply::square(item.a.data(), item.a.size(), item.square.data());
+        cases.push_back(std::move(item));
+    }
+    Parallel::set_threads(threads);
+    return cases;
+}
+
+// the number of wrong products and squares with the current threads
+int check_parallel_products(const std::vector<ParallelCase>& cases) {
+    int wrong = 0;
+    for (const auto& item : cases) {
+        const auto& a = item.a;
+        const auto& b = item.b;
+        std::vector<uint64_t> result(item.product.size());
+        Multiply::multiply(a.data(), a.size(), b.data(), b.size(), result.data());
+        wrong += result != item.product;
+        std::vector<uint64_t> square(item.square.size());
+        Multiply::square(a.data(), a.size(), square.data());
+        wrong += square != item.square;
+        Multiply::Prepared prepared(b.data(), b.size(), a.size());
+        prepared.multiply(a.data(), a.size(), b.data(), b.size(), result.data());
+        wrong += result != item.product;
+    }
+    return wrong;
+}
+
+TEST(ParallelTests, Products) {
+    Parallel::set_threads(4);
+    // Toom-3, Karatsuba over the NTT and the NTT itself
+    ASSERT_EQ(0, check_parallel_products(parallel_cases({1100, 2500, 8000})));
+    Multiply::set_large_engine(Multiply::Engine::kFFT);
+    ASSERT_EQ(0, check_parallel_products(parallel_cases({1100})));
+    Multiply::set_large_engine(Multiply::Engine::kNTT);
+    Parallel::set_threads(1);
+}
+
+TEST(ParallelTests, NestedTasksAndExceptions) {
+    Parallel::set_threads(3);
+    std::atomic<int> count = 0;
+    auto leaf = [&] { ++count; };
+    auto inner = [&] { Parallel::run({leaf, leaf, leaf}); };
+    Parallel::run({inner, inner, inner, inner});
+    ASSERT_EQ(12, count);
+    auto failing = [] { throw std::logic_error("task"); };
+    ASSERT_THROW(Parallel::run({leaf, failing, leaf}), std::logic_error);
+    ASSERT_EQ(14, count);
+    Parallel::run({leaf, leaf}, false);
+    ASSERT_EQ(16, count);
+    Parallel::set_threads(1);
+}
+
+TEST(ParallelTests, BigIntegerProductsInTasks) {
+    // the products run in parallel themselves, and a thread that waits for
+    // them must not start another task with a product in its buffers
+    BigInteger a = random_bigint(58000), b = random_bigint(96000);
+    BigInteger c = random_bigint(96000), d = random_bigint(58000);
+    Parallel::set_threads(1);
+    BigInteger ab = a * b, cd = c * d, ac = a * c;
+    Parallel::set_threads(2);
+    for (int round = 0; round < 3; ++round) {
+        BigInteger x, y, z, w, v;
+        Parallel::run({[&] { x = a; x *= b; },
+                       [&] { z = a * c; },
+                       [&] { y = c; y *= d; },
+                       [&] { w = c * d; },
+                       [&] { v = b * a; }});
+        ASSERT_EQ(ab, x);
+        ASSERT_EQ(cd, y);
+        ASSERT_EQ(ac, z);
+        ASSERT_EQ(cd, w);
+        ASSERT_EQ(ab, v);
+    }
+    Parallel::set_threads(1);
+}
+
+TEST(ParallelTests, SharedByThreads) {
+    Parallel::set_threads(4);
+    auto cases = parallel_cases({1500, 3000});
+    int failures = run_concurrently([&](size_t) {
+        return check_parallel_products(cases);
+    });
+    ASSERT_EQ(0, failures);
+    Parallel::set_threads(1);
+}
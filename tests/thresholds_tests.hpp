@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "bigint_test_helper.hpp"
+#include "thresholds.hpp"
+
+TEST(ThresholdsTests, ProfileRoundTrip) {
+    Thresholds thresholds;
+    thresholds.karatsuba = 17;
+    thresholds.ntt = 5000;
+    thresholds.newton_reciprocal = 99;
+    std::stringstream profile;
+    thresholds.write(profile);
+    ASSERT_EQ(thresholds, Thresholds::parse(profile));
+
+    // comments, blank lines and the defaults of the missing names
+    std::istringstream partial("# measured on a laptop\n\n  toom3 300\n");
+    Thresholds expected;
+    expected.toom3 = 300;
+    ASSERT_EQ(expected, Thresholds::parse(partial));
+}
+
+TEST(ThresholdsTests, ParseErrors) {
+    for (std::string profile :
+         {"karatsuba", "karatsuba 0", "karatsuba 3", "newton_reciprocal 1",
+          "karatsuba -5", "karatsuba 12x",
+          "karatsuba 12 13", "unknown 12",
+          "karatsuba 99999999999999999999999"}) {
+        std::istringstream in(profile);
+        ASSERT_THROW(Thresholds::parse(in), std::invalid_argument) << profile;
+    }
+    Thresholds too_small;
+    too_small.toom3_square = 2;
+    ASSERT_THROW(Thresholds::set(too_small), std::invalid_argument);
+    ASSERT_EQ(Thresholds(), Thresholds::current());
+}
+
+TEST(ThresholdsTests, Load) {
+    auto path = std::filesystem::temp_directory_path() / "thresholds_test.txt";
+    Thresholds thresholds;
+    thresholds.fft_square = 12345;
+    {
+        std::ofstream out(path);
+        thresholds.write(out);
+    }
+    ASSERT_EQ(thresholds, Thresholds::load(path.string()));
+    std::filesystem::remove(path);
+    ASSERT_THROW(Thresholds::load(path.string()), std::runtime_error);
+}
+
+TEST(ThresholdsTests, EveryAlgorithm) {
+    // the same results with every algorithm taken from small sizes on
+    Thresholds initial = Thresholds::current();
+    std::vector<std::pair<BigInteger, BigInteger>> operands;
+    for (size_t size : {40, 300, 2000}) {
+        operands.emplace_back(random_bigint(size * 19), random_bigint(size * 10));
+    }
+    BigInteger::Reciprocal made_before(operands.back().second);
+    std::vector<BigInteger> expected;
+    for (const auto& [a, b] : operands) {
+        expected.push_back(a * b);
+        expected.push_back(a.square());
+        expected.push_back(a / b);
+        expected.push_back(a % b);
+    }
+    expected.push_back(operands.back().first % operands.back().second);
+    // the products by Karatsuba and Toom-3 with the recursive division,
+    // then the transforms with the division through reciprocals
+    Thresholds splits;
+    splits.karatsuba = splits.karatsuba_square = 4;
+    splits.toom3 = splits.toom3_square = 8;
+    splits.recursive_division = 2;
+    Thresholds transforms = splits;
+    transforms.ntt = transforms.fft = 8;
+    transforms.ntt_square = transforms.fft_square = 8;
+    transforms.parallel = 1;
+    transforms.barrett_division = 1;
+    transforms.newton_division = transforms.newton_reciprocal = 2;
+    for (auto engine : {Multiply::Engine::kNTT, Multiply::Engine::kFFT}) {
+        for (const auto& small : {splits, transforms}) {
+            Multiply::set_large_engine(engine);
+            Thresholds::set(small);
+            std::vector<BigInteger> result;
+            for (const auto& [a, b] : operands) {
+                result.push_back(a * b);
+                result.push_back(a.square());
+                result.push_back(a / b);
+                result.push_back(a % b);
+            }
+            // a reciprocal made with other thresholds still divides
+            const auto& [a, b] = operands.back();
+            result.push_back(BigInteger::divide(a, made_before).second);
+            Thresholds::set(initial);
+            ASSERT_EQ(expected, result);
+        }
+    }
+    Multiply::set_large_engine(Multiply::Engine::kNTT);
+}
+
+TEST(ThresholdsTests, FindCrossover) {
+    // the upper algorithm wins from 2500 on
+    auto cost = [](size_t size, bool upper) {
+        double n = double(size);
+        return upper ? 50 * n * std::sqrt(n) : n * n;
+    };
+    size_t crossover = Thresholds::find_crossover(100, 100000, cost);
+    ASSERT_GE(crossover, 2500);
+    ASSERT_LE(crossover, 2500 * 5 / 4);
+
+    // a single faster measurement is taken for noise
+    auto noisy = [](size_t size, bool upper) {
+        return upper && size == 125 ? 0.0 : upper ? 2.0 : 1.0;
+    };
+    ASSERT_EQ(1000, Thresholds::find_crossover(100, 1000, noisy));
+    auto always = [](size_t, bool upper) { return upper ? 1.0 : 2.0; };
+    ASSERT_EQ(100, Thresholds::find_crossover(100, 1000, always));
+}
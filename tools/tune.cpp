@@ -0,0 +1,29 @@
+#include <fstream>
+#include <iostream>
+
+#include "parallel.hpp"
+#include "thresholds.hpp"
+
+// Measures the thresholds on this machine and writes the profile to the
+// file given, or to the standard output; the progress goes to stderr.
+// Use the profile with BIGINT_THRESHOLDS=<file>.
+int main(int argc, char* argv[]) {
+  if (argc > 2) {
+    std::cerr << "usage: " << argv[0] << " [profile]\n";
+    return 1;
+  }
+  // the parallel threshold is measured with all the hardware threads
+  Parallel::set_threads(0);
+  Thresholds thresholds = Thresholds::calibrate(&std::cerr);
+  if (argc == 1) {
+    thresholds.write(std::cout);
+    return 0;
+  }
+  std::ofstream out(argv[1]);
+  thresholds.write(out);
+  if (!out) {
+    std::cerr << "can't write " << argv[1] << '\n';
+    return 1;
+  }
+  return 0;
+}